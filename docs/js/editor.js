@@ -23,8 +23,7 @@ function tokenizeMathPad(text, options = {}) {
     const strippedText = text.replace(/\n*"\*?--- Reference Constants and Functions ---"[\s\S]*$/, '');
 
     // Tokenize first to find quoted comments (they take precedence)
-    const tokenizer = new Tokenizer(text);
-    const parserTokens = tokenizer.tokenize();  // Token[][]
+    const parserTokens = tokenize(text);  // Token[][]
 
     // Flatten for sequential position-based operations (highlight loop, comment region detection)
     const flatTokens = parserTokens.flat();
@@ -2,6 +2,15 @@
  * MathPad Evaluator - Expression evaluation with all built-in functions
  */
 
+/**
+ * Default limit on nested user-function calls in one evaluate() (see
+ * EvalContext.maxCallDepth). evaluate() keeps its own stack, so this only
+ * has to stop runaway recursion, not protect the JS call stack. (The
+ * interval, batch and dual evaluators recurse natively; their can*()
+ * checks reject recursive user functions.)
+ */
+const MAX_CALL_DEPTH = 10000;
+
 /**
  * Evaluation context - holds variables and settings
  */
@@ -18,6 +27,8 @@ class EvalContext {
         this.usedFunctions = new Set();
         this.preSolveValues = null; // Map of variable name → {value, isOutput} before solve started
         this.places = 4; // Decimal places for tolerance calculations
+        this.sharedValues = null; // Per-evaluation memo for SHARED nodes (see specializeForUnknown)
+        this.maxCallDepth = MAX_CALL_DEPTH; // Nested user-function calls allowed per evaluate()
     }
 
     setVariable(name, value) {
@@ -108,6 +119,7 @@ class EvalContext {
         ctx.usedConstants = this.usedConstants; // Share tracking with parent
         ctx.usedFunctions = this.usedFunctions;
         ctx.preSolveValues = this.preSolveValues; // Share pre-solve values
+        ctx.maxCallDepth = this.maxCallDepth;
         return ctx;
     }
 
@@ -126,6 +138,7 @@ class EvalContext {
         ctx.degreesMode = this.degreesMode;
         ctx.usedConstants = this.usedConstants; // Share tracking with parent
         ctx.usedFunctions = this.usedFunctions;
+        ctx.maxCallDepth = this.maxCallDepth;
         return ctx;
     }
 }
@@ -215,38 +228,121 @@ const _dateLocale = (() => {
     }
 })();
 
+// Single-pass scanners for date/duration literals. Character classes match
+// the regex forms they replace: \d is ASCII 0-9, \s is JS whitespace.
+function _isSpaceCode(c) {
+    return c === 32 || (c >= 9 && c <= 13) || c === 0xa0 || c === 0x1680
+        || (c >= 0x2000 && c <= 0x200a) || c === 0x2028 || c === 0x2029
+        || c === 0x202f || c === 0x205f || c === 0x3000 || c === 0xfeff;
+}
+
+// Length of the ASCII digit run starting at i
+function _digitRun(t, i) {
+    let j = i;
+    while (j < t.length && _isDigitCode(t.charCodeAt(j))) j++;
+    return j - i;
+}
+
+// Integer value of t[i, i+n) — same as parseInt on those digits (long runs
+// defer to parseInt, whose rounding an accumulating loop wouldn't reproduce)
+function _digitsValue(t, i, n) {
+    if (n > 15) return parseInt(t.substring(i, i + n), 10);
+    let v = 0;
+    for (let k = i; k < i + n; k++) v = v * 10 + (t.charCodeAt(k) - 48);
+    return v;
+}
+
+// Scan `\d{2}(?:\.\d+)?` running to the end of t; returns { value } as
+// parseFloat would give it, or null. Up to 15 digits, N / 10^k is a single
+// correctly rounded division — exactly parseFloat's result.
+function _scanSeconds(t, i) {
+    if (_digitRun(t, i) !== 2) return null;
+    if (i + 2 === t.length) return { value: _digitsValue(t, i, 2) };
+    if (t.charCodeAt(i + 2) !== 46) return null; // '.'
+    const n = _digitRun(t, i + 3);
+    if (n === 0 || i + 3 + n !== t.length) return null;
+    if (n > 13) return { value: parseFloat(t.substring(i)) };
+    return { value: (_digitsValue(t, i, 2) * Math.pow(10, n) + _digitsValue(t, i + 3, n)) / Math.pow(10, n) };
+}
+
+// Scan an optional time suffix `\s+\d{1,2}:\d{2}(?::SS)?` running to the end
+// of t. Returns { hour, minute, second } (zeros when absent) or null.
+function _scanTimeSuffix(t, i) {
+    if (i === t.length) return { hour: 0, minute: 0, second: 0 };
+    let j = i;
+    while (j < t.length && _isSpaceCode(t.charCodeAt(j))) j++;
+    if (j === i) return null;
+    const hn = _digitRun(t, j);
+    if (hn < 1 || hn > 2 || t.charCodeAt(j + hn) !== 58) return null; // ':'
+    const mi = j + hn + 1;
+    if (_digitRun(t, mi) !== 2) return null;
+    const time = { hour: _digitsValue(t, j, hn), minute: _digitsValue(t, mi, 2), second: 0 };
+    if (mi + 2 === t.length) return time;
+    if (t.charCodeAt(mi + 2) !== 58) return null;
+    const sec = _scanSeconds(t, mi + 3);
+    if (!sec) return null;
+    time.second = sec.value;
+    return time;
+}
+
+function _isDateSeparatorCode(c) {
+    return c === 47 || c === 45 || c === 46; // / - .
+}
+
 /**
  * Parse date text to epoch seconds, using locale-detected field order.
  * Accepts any separator between date fields (-, /, .).
  * Optional time: HH:MM[:SS[.mmm]]
  * Returns null if text doesn't match.
+ *
+ * Hand-written scanner equivalent to
+ *   ^(\d{1,4})[\/\-.](\d{1,4})[\/\-.](\d{1,4})(?:\s+(\d{1,2}):(\d{2})(?::(\d{2}(?:\.\d+)?))?)?$
+ * falling back to the 2-part M/D form (1-2 digit fields, current year).
+ * Epoch conversion stays with Date, which owns local-time and DST rules.
  */
 function parseDateText(text) {
-    // Try 3-part date (M/D/Y or locale equivalent)
-    let m = text.trim().match(/^(\d{1,4})[\/\-.](\d{1,4})[\/\-.](\d{1,4})(?:\s+(\d{1,2}):(\d{2})(?::(\d{2}(?:\.\d+)?))?)?$/);
-    // Try 2-part date (M/D — use current year)
-    if (!m) {
-        m = text.trim().match(/^(\d{1,2})[\/\-.](\d{1,2})(?:\s+(\d{1,2}):(\d{2})(?::(\d{2}(?:\.\d+)?))?)?$/);
-        if (m) {
-            // Insert current year as third group, shift time groups
-            const yr = String(new Date().getFullYear());
-            m = [m[0], m[1], m[2], yr, m[3], m[4], m[5]];
-        }
-    }
-    if (!m) return null;
+    const t = text.trim();
+    const fields = [];
+    let i = 0;
+    let time = null;
+    // Up to three separated digit fields, then the optional time suffix
+    while (fields.length < 3) {
+        const n = _digitRun(t, i);
+        if (n < 1 || n > 4) break;
+        fields.push({ start: i, length: n });
+        i += n;
+        if (fields.length < 3 && i < t.length && _isDateSeparatorCode(t.charCodeAt(i))) {
+            i++;
+        } else {
+            break;
+        }
+    }
+    if (fields.length === 3) {
+        time = _scanTimeSuffix(t, i);
+    }
+    if (!time) {
+        // 2-part date (M/D — use current year)
+        if (fields.length < 2 || fields[0].length > 2 || fields[1].length > 2) return null;
+        const end = fields[1].start + fields[1].length;
+        time = _scanTimeSuffix(t, end);
+        if (!time) return null;
+        fields.length = 2;
+        fields.push({ value: new Date().getFullYear() });
+    }
+    const value = f => f.value !== undefined ? f.value : _digitsValue(t, f.start, f.length);
     let month, day, year;
     if (_dateLocale.order === 'dmy') {
-        day = parseInt(m[1]); month = parseInt(m[2]); year = parseInt(m[3]);
+        day = value(fields[0]); month = value(fields[1]); year = value(fields[2]);
     } else if (_dateLocale.order === 'ymd') {
-        year = parseInt(m[1]); month = parseInt(m[2]); day = parseInt(m[3]);
+        year = value(fields[0]); month = value(fields[1]); day = value(fields[2]);
     } else { // mdy
-        month = parseInt(m[1]); day = parseInt(m[2]); year = parseInt(m[3]);
+        month = value(fields[0]); day = value(fields[1]); year = value(fields[2]);
     }
     // 2-digit year: assume current century
     if (year < 100) year += Math.floor(new Date().getFullYear() / 100) * 100;
-    const hour = m[4] ? parseInt(m[4]) : 0;
-    const minute = m[5] ? parseInt(m[5]) : 0;
-    const second = m[6] ? parseFloat(m[6]) : 0;
+    const hour = time.hour;
+    const minute = time.minute;
+    const second = time.second;
     const wholeSec = Math.floor(second);
     const ms = Math.round((second - wholeSec) * 1000);
     return new Date(year, month - 1, day, hour, minute, wholeSec, ms).getTime() / 1000;
@@ -254,29 +350,51 @@ function parseDateText(text) {
 
 /**
  * Parse duration text to seconds. Accepts:
- *   H:MM:SS[.mmm], H:MM, or plain number (hours)
+ *   Nd H:MM[:SS[.mmm]], H:MM:SS[.mmm], H:MM, or plain number (hours)
  * Returns null if text doesn't match.
+ * Single-pass scanner; the fixed-width fields follow the same rules as the
+ * date time suffix (\d{2} minutes and seconds, optional .fraction).
  */
 function parseDurationText(text) {
     const t = text.trim();
-    // Nd H:MM:SS[.mmm] or Nd H:MM
-    const md = t.match(/^(-?)(\d+)d\s+(\d+):(\d{2})(?::(\d{2}(?:\.\d+)?))?$/);
-    if (md) {
-        const sign = md[1] === '-' ? -1 : 1;
-        const secs = md[5] ? parseFloat(md[5]) : 0;
-        return sign * (parseInt(md[2]) * 86400 + parseInt(md[3]) * 3600 + parseInt(md[4]) * 60 + secs);
-    }
-    // H:MM:SS[.mmm]
-    const m3 = t.match(/^(-?)(\d+):(\d{2}):(\d{2}(?:\.\d+)?)$/);
-    if (m3) {
-        const sign = m3[1] === '-' ? -1 : 1;
-        return sign * (parseInt(m3[2]) * 3600 + parseInt(m3[3]) * 60 + parseFloat(m3[4]));
-    }
-    // H:MM
-    const m2 = t.match(/^(-?)(\d+):(\d{2})$/);
-    if (m2) {
-        const sign = m2[1] === '-' ? -1 : 1;
-        return sign * (parseInt(m2[2]) * 3600 + parseInt(m2[3]) * 60);
+    let i = 0;
+    const sign = t.charCodeAt(0) === 45 ? -1 : 1; // '-'
+    if (sign < 0) i++;
+    const n1 = _digitRun(t, i);
+    if (n1 > 0) {
+        const c = t.charCodeAt(i + n1);
+        if (c === 100) {
+            // Nd H:MM:SS[.mmm] or Nd H:MM
+            let j = i + n1 + 1;
+            const ws = j;
+            while (j < t.length && _isSpaceCode(t.charCodeAt(j))) j++;
+            const hn = _digitRun(t, j);
+            const mi = j + hn + 1;
+            if (j > ws && hn > 0 && t.charCodeAt(j + hn) === 58 && _digitRun(t, mi) === 2) {
+                let secs = null;
+                if (mi + 2 === t.length) {
+                    secs = 0;
+                } else if (t.charCodeAt(mi + 2) === 58) {
+                    const sec = _scanSeconds(t, mi + 3);
+                    if (sec) secs = sec.value;
+                }
+                if (secs !== null) {
+                    return sign * (_digitsValue(t, i, n1) * 86400 + _digitsValue(t, j, hn) * 3600
+                        + _digitsValue(t, mi, 2) * 60 + secs);
+                }
+            }
+        } else if (c === 58 && _digitRun(t, i + n1 + 1) === 2) {
+            const mi = i + n1 + 1;
+            if (mi + 2 === t.length) {
+                // H:MM
+                return sign * (_digitsValue(t, i, n1) * 3600 + _digitsValue(t, mi, 2) * 60);
+            }
+            if (t.charCodeAt(mi + 2) === 58) {
+                // H:MM:SS[.mmm]
+                const sec = _scanSeconds(t, mi + 3);
+                if (sec) return sign * (_digitsValue(t, i, n1) * 3600 + _digitsValue(t, mi, 2) * 60 + sec.value);
+            }
+        }
     }
     // Plain number (hours)
     const num = Number(t);
@@ -603,117 +721,1024 @@ const builtinFunctions = {
 };
 
 /**
- * Evaluate an AST node
+ * Thrown when user-function calls nest deeper than the context's
+ * maxCallDepth. Not an EvalError on purpose: callers that skip an
+ * expression on EvalError ("doesn't apply here") must still surface
+ * runaway recursion.
+ */
+class CallDepthError extends Error {
+    constructor(message) {
+        super(message);
+        this.name = 'CallDepthError';
+    }
+}
+
+function _variableValue(name, context) {
+    const value = context.getVariable(name);
+    if (value !== undefined) {
+        return value;
+    }
+    // Check if declared but no value vs truly undefined
+    if (context.isDeclared(name)) {
+        throw new EvalError(`Variable '${name}' has no value`);
+    }
+    throw new EvalError(`Undefined variable: ${name}`);
+}
+
+function _postfixValue(node, context) {
+    if (node.op === '~') {
+        // x~ — get pre-solve value (value before this solve started)
+        if (node.operand.type !== 'VARIABLE') {
+            throw new EvalError('~ operator can only be applied to variables');
+        }
+        const name = node.operand.name;
+        // Unshadowed constants always have a pre-solve value
+        if (context.constants.has(name) && !context.shadowedConstants.has(name)) {
+            return context.constants.get(name);
+        }
+        if (!context.isDeclared(name)) {
+            throw new EvalError(`Undefined variable: ${name}`);
+        }
+        const value = context.getPreSolveValue(name);
+        if (value !== undefined) {
+            return value;
+        }
+        throw new EvalError(`Variable '${name}' has no pre-solve value`);
+    }
+    if (node.op === '?') {
+        // x~? — does variable have a pre-solve value?
+        if (node.operand.type !== 'POSTFIX_OP' || node.operand.op !== '~') {
+            throw new EvalError('? operator requires ~ (use x~? to check for pre-solve value)');
+        }
+        const varNode = node.operand.operand;
+        if (varNode.type !== 'VARIABLE') {
+            throw new EvalError('~? operator can only be applied to variables');
+        }
+        const varName = varNode.name;
+        // Unshadowed constants always have a pre-solve value
+        if (context.constants.has(varName) && !context.shadowedConstants.has(varName)) {
+            return 1;
+        }
+        if (!context.isDeclared(varName)) {
+            throw new EvalError(`Undefined variable: ${varName}`);
+        }
+        return context.preSolveValues.has(varName) ? 1 : 0;
+    }
+    throw new EvalError(`Unknown postfix operator: ${node.op}`);
+}
+
+function _unaryValue(op, operand) {
+    switch (op) {
+        case '-': return -operand;
+        case '+': return +operand;
+        case '~': return ~Math.trunc(operand);
+        case '!': return operand ? 0 : 1;
+        default:
+            throw new EvalError(`Unknown unary operator: ${op}`);
+    }
+}
+
+function _binaryValue(op, left, right) {
+    switch (op) {
+        case '+': return left + right;
+        case '-': return left - right;
+        case '*': return left * right;
+        case '/':
+            // Allow division by zero to return Infinity/-Infinity/NaN
+            return left / right;
+        case '**': return Math.pow(left, right);
+        case '<<': return Math.trunc(left) << Math.trunc(right);
+        case '>>': return Math.trunc(left) >> Math.trunc(right);
+        case '&': return Math.trunc(left) & Math.trunc(right);
+        case '|': return Math.trunc(left) | Math.trunc(right);
+        case '^': return Math.trunc(left) ^ Math.trunc(right);
+        case '==': return left === right ? 1 : 0;
+        case '!=': return left !== right ? 1 : 0;
+        case '<': return left < right ? 1 : 0;
+        case '<=': return left <= right ? 1 : 0;
+        case '>': return left > right ? 1 : 0;
+        case '>=': return left >= right ? 1 : 0;
+        case '^^': return (left ? 1 : 0) !== (right ? 1 : 0) ? 1 : 0; // XOR
+        default:
+            throw new EvalError(`Unknown binary operator: ${op}`);
+    }
+}
+
+// Evaluation stack shared by all evaluate() calls. A frame is one slot in
+// each of the parallel frame arrays: the node, its context, how far its
+// evaluation has got (step) and any state it keeps between steps. Results
+// go on _values. Each call works above what is already on the stacks and
+// cuts them back to where it started if it throws.
+const _frameNodes = [];
+const _frameContexts = [];
+const _frameSteps = [];
+const _frameStates = [];
+const _values = [];
+
+// Frame states of calls that aren't user functions or builtins
+const _IF_CALL = { kind: 'if' };
+const _SUM_CALL = { kind: 'sum' };
+const _PROD_CALL = { kind: 'prod' };
+
+// Step of a user-function frame whose body is being evaluated
+const _RETURN_STEP = -1;
+
+function _popFrame() {
+    _frameNodes.pop();
+    _frameContexts.pop();
+    _frameSteps.pop();
+    _frameStates.pop();
+}
+
+/**
+ * Start evaluating node: leaves are evaluated right away onto the value
+ * stack, anything else gets a frame
+ */
+function _pushNode(node, context) {
+    if (node === null) {
+        _values.push(0);
+        return;
+    }
+    switch (node.type) {
+        case 'NUMBER':
+            _values.push(node.value);
+            return;
+        case 'VARIABLE':
+            _values.push(_variableValue(node.name, context));
+            return;
+        case 'POSTFIX_OP':
+            _values.push(_postfixValue(node, context));
+            return;
+    }
+    _frameNodes.push(node);
+    _frameContexts.push(context);
+    _frameSteps.push(0);
+    _frameStates.push(null);
+}
+
+/**
+ * Finish frame top by evaluating node in its place (tail position: if()
+ * branches, unmemoized SHARED nodes)
+ */
+function _replaceFrame(top, node, context) {
+    if (node === null || node.type === 'NUMBER' || node.type === 'VARIABLE' || node.type === 'POSTFIX_OP') {
+        _popFrame();
+        _pushNode(node, context);
+        return;
+    }
+    _frameNodes[top] = node;
+    _frameContexts[top] = context;
+    _frameSteps[top] = 0;
+    _frameStates[top] = null;
+}
+
+/**
+ * Work out what a FUNCTION_CALL frame calls, checking its arguments the way
+ * the call would before any are evaluated: a user function, a builtin, or
+ * one of the lazily evaluated forms if(), sum() and prod()
+ */
+function _resolveCall(node, context) {
+    const funcName = node.name.toLowerCase();
+
+    // Check for user-defined function first
+    const userFunc = context.getUserFunction(funcName);
+    if (userFunc) {
+        const expected = userFunc.params.length;
+        if (node.args.length !== expected) {
+            throw new EvalError(`${node.name}() requires ${expected} argument${expected !== 1 ? 's' : ''}, got ${node.args.length}`);
+        }
+        return userFunc;
+    }
+
+    // 'if' evaluates only the branch taken, so recursion can terminate
+    if (funcName === 'if') {
+        validateArgCount(funcName, node.args.length);
+        return _IF_CALL;
+    }
+
+    // Binding-variable iteration forms: sum(expr; var; start; end)
+    // and prod(expr; var; start; end)
+    if (funcName === 'sum' || funcName === 'prod') {
+        if (node.args.length !== 4) {
+            throw new EvalError(`${funcName}() requires 4 arguments: ${funcName}(expr; var; start; end)`);
+        }
+        if (node.args[1].type !== 'VARIABLE') {
+            throw new EvalError(`${funcName}() second argument must be a variable name`);
+        }
+        return funcName === 'sum' ? _SUM_CALL : _PROD_CALL;
+    }
+
+    // Check built-in functions
+    const builtin = builtinFunctions[funcName];
+    if (builtin) {
+        validateArgCount(funcName, node.args.length);
+        return builtin;
+    }
+
+    throw new EvalError(`Unknown function: ${node.name}`);
+}
+
+/**
+ * Evaluate an AST node. Recurses for the first NATIVE_EVAL_DEPTH levels of
+ * nesting (fast), then continues on an explicit stack, so neither deeply
+ * nested expressions nor deep user-function recursion (e.g. wallis(6000))
+ * can overflow the JS call stack. Nested user-function calls are limited
+ * to context.maxCallDepth; going deeper throws CallDepthError naming the
+ * function.
  */
 function evaluate(node, context) {
+    return _evaluateNested(node, context, 0, 0);
+}
+
+// Levels of nesting evaluated by plain recursion before switching to the
+// explicit stack
+const NATIVE_EVAL_DEPTH = 200;
+
+function _callTooDeep(node, maxDepth) {
+    return new CallDepthError(`${node.name}() exceeded the maximum call depth of ${maxDepth} (runaway recursion?)`);
+}
+
+/**
+ * Recursive evaluation at the given nesting level, with `calls` user
+ * functions already in progress
+ */
+function _evaluateNested(node, context, nesting, calls) {
     if (node === null) return 0;
+    if (nesting >= NATIVE_EVAL_DEPTH) return _evaluateOnStack(node, context, calls);
+    const next = nesting + 1;
 
     switch (node.type) {
         case 'NUMBER':
             return node.value;
 
-        case 'VARIABLE': {
-            const value = context.getVariable(node.name);
-            if (value !== undefined) {
-                return value;
+        case 'VARIABLE':
+            return _variableValue(node.name, context);
+
+        case 'UNARY_OP':
+            return _unaryValue(node.op, _evaluateNested(node.operand, context, next, calls));
+
+        case 'POSTFIX_OP':
+            return _postfixValue(node, context);
+
+        case 'BINARY_OP': {
+            // Short-circuit evaluation for logical operators
+            if (node.op === '&&') {
+                const left = _evaluateNested(node.left, context, next, calls);
+                if (!left) return 0;
+                return _evaluateNested(node.right, context, next, calls) ? 1 : 0;
             }
-            // Check if declared but no value vs truly undefined
-            if (context.isDeclared(node.name)) {
-                throw new EvalError(`Variable '${node.name}' has no value`);
+            if (node.op === '||') {
+                const left = _evaluateNested(node.left, context, next, calls);
+                if (left) return 1;
+                return _evaluateNested(node.right, context, next, calls) ? 1 : 0;
             }
-            throw new EvalError(`Undefined variable: ${node.name}`);
+            const left = _evaluateNested(node.left, context, next, calls);
+            const right = _evaluateNested(node.right, context, next, calls);
+            return _binaryValue(node.op, left, right);
         }
 
-        case 'UNARY_OP': {
-            const operand = evaluate(node.operand, context);
-            switch (node.op) {
-                case '-': return -operand;
-                case '+': return +operand;
-                case '~': return ~Math.trunc(operand);
-                case '!': return operand ? 0 : 1;
-                default:
-                    throw new EvalError(`Unknown unary operator: ${node.op}`);
-            }
-        }
+        case 'FUNCTION_CALL': {
+            const callee = _resolveCall(node, context);
+            const args = node.args;
 
-        case 'POSTFIX_OP': {
-            if (node.op === '~') {
-                // x~ — get pre-solve value (value before this solve started)
-                if (node.operand.type !== 'VARIABLE') {
-                    throw new EvalError('~ operator can only be applied to variables');
-                }
-                const name = node.operand.name;
-                // Unshadowed constants always have a pre-solve value
-                if (context.constants.has(name) && !context.shadowedConstants.has(name)) {
-                    return context.constants.get(name);
+            if (callee === _IF_CALL) {
+                const condition = _evaluateNested(args[0], context, next, calls);
+                if (condition) {
+                    return _evaluateNested(args[1], context, next, calls);
                 }
-                if (!context.isDeclared(name)) {
-                    throw new EvalError(`Undefined variable: ${name}`);
+                return args.length > 2 ? _evaluateNested(args[2], context, next, calls) : 0;
+            }
+
+            if (callee === _SUM_CALL || callee === _PROD_CALL) {
+                const funcName = callee.kind;
+                const varName = args[1].name;
+                const start = Math.floor(_evaluateNested(args[2], context, next, calls));
+                const end = Math.floor(_evaluateNested(args[3], context, next, calls));
+                _checkIterationRange(funcName, start, end);
+                const iterContext = context.clone();
+                if (funcName === 'sum') {
+                    // Collect terms in iteration order, then sum (precise when
+                    // available; reduce() otherwise — identical to the old loop).
+                    const terms = [];
+                    for (let i = start; i <= end; i++) {
+                        iterContext.setVariable(varName, i);
+                        terms.push(_evaluateNested(args[0], iterContext, next, calls));
+                    }
+                    return _preciseSum(terms);
                 }
-                const value = context.getPreSolveValue(name);
-                if (value !== undefined) {
-                    return value;
+                let total = 1;
+                for (let i = start; i <= end; i++) {
+                    iterContext.setVariable(varName, i);
+                    total *= _evaluateNested(args[0], iterContext, next, calls);
                 }
-                throw new EvalError(`Variable '${name}' has no pre-solve value`);
+                return total;
             }
-            if (node.op === '?') {
-                // x~? — does variable have a pre-solve value?
-                if (node.operand.type !== 'POSTFIX_OP' || node.operand.op !== '~') {
-                    throw new EvalError('? operator requires ~ (use x~? to check for pre-solve value)');
-                }
-                const varNode = node.operand.operand;
-                if (varNode.type !== 'VARIABLE') {
-                    throw new EvalError('~? operator can only be applied to variables');
+
+            // Evaluate arguments in the calling context
+            const argValues = args.map(arg => _evaluateNested(arg, context, next, calls));
+            if (typeof callee === 'function') {
+                return callee(argValues, context);
+            }
+            if (calls >= context.maxCallDepth) throw _callTooDeep(node, context.maxCallDepth);
+            // Create function context with only constants and user functions (no variables)
+            const funcContext = context.cloneForFunction();
+            for (let i = 0; i < callee.params.length; i++) {
+                funcContext.setVariable(callee.params[i], argValues[i] !== undefined ? argValues[i] : 0);
+            }
+            return _evaluateNested(callee.body, funcContext, next, calls + 1);
+        }
+
+        case 'SHARED': {
+            // Repeated subexpression hoisted by specializeForUnknown. Only the
+            // solver's f(x) context carries a memo; clones (sum/prod iteration)
+            // and function contexts evaluate the expression directly.
+            const memo = context.sharedValues;
+            if (!memo) return _evaluateNested(node.expr, context, next, calls);
+            let value = memo[node.slot];
+            if (value === undefined) {
+                value = _evaluateNested(node.expr, context, next, calls);
+                memo[node.slot] = value;
+            }
+            return value;
+        }
+
+        default:
+            throw new EvalError(`Unknown node type: ${node.type}`);
+    }
+}
+
+function _checkIterationRange(funcName, start, end) {
+    if (!isFinite(start) || !isFinite(end)) {
+        throw new EvalError(`${funcName}() start and end must be finite numbers`);
+    }
+    const iterations = end - start + 1;
+    if (iterations > 10000000) {
+        throw new EvalError(`${funcName}() too many iterations (${iterations}). Max is 10,000,000`);
+    }
+}
+
+/**
+ * Evaluate node on the explicit stack (no JS recursion), with `calls`
+ * user functions already in progress
+ */
+function _evaluateOnStack(node, context, calls) {
+    if (node === null) return 0;
+    switch (node.type) {
+        case 'NUMBER': return node.value;
+        case 'VARIABLE': return _variableValue(node.name, context);
+        case 'POSTFIX_OP': return _postfixValue(node, context);
+    }
+
+    const base = _frameNodes.length;
+    const valueBase = _values.length;
+    let depth = calls; // user-function calls in progress
+    _pushNode(node, context);
+    try {
+        while (_frameNodes.length > base) {
+            const top = _frameNodes.length - 1;
+            const n = _frameNodes[top];
+            const ctx = _frameContexts[top];
+            const step = _frameSteps[top];
+
+            switch (n.type) {
+                case 'UNARY_OP':
+                    if (step === 0) {
+                        _frameSteps[top] = 1;
+                        _pushNode(n.operand, ctx);
+                    } else {
+                        _popFrame();
+                        _values.push(_unaryValue(n.op, _values.pop()));
+                    }
+                    break;
+
+                case 'BINARY_OP': {
+                    if (step === 0) {
+                        _frameSteps[top] = 1;
+                        _pushNode(n.left, ctx);
+                        break;
+                    }
+                    // Short-circuit evaluation for logical operators
+                    if (n.op === '&&' || n.op === '||') {
+                        if (step === 1) {
+                            const left = _values.pop();
+                            if (n.op === '&&' ? !left : left) {
+                                _popFrame();
+                                _values.push(left ? 1 : 0);
+                            } else {
+                                _frameSteps[top] = 2;
+                                _pushNode(n.right, ctx);
+                            }
+                        } else {
+                            _popFrame();
+                            _values.push(_values.pop() ? 1 : 0);
+                        }
+                        break;
+                    }
+                    if (step === 1) {
+                        _frameSteps[top] = 2;
+                        _pushNode(n.right, ctx);
+                        break;
+                    }
+                    _popFrame();
+                    const right = _values.pop();
+                    _values.push(_binaryValue(n.op, _values.pop(), right));
+                    break;
                 }
-                const varName = varNode.name;
-                // Unshadowed constants always have a pre-solve value
-                if (context.constants.has(varName) && !context.shadowedConstants.has(varName)) {
-                    return 1;
+
+                case 'FUNCTION_CALL': {
+                    if (step === _RETURN_STEP) {
+                        // Body evaluated; its value is the call's value
+                        depth--;
+                        _popFrame();
+                        break;
+                    }
+                    let callee = _frameStates[top];
+                    if (step === 0) {
+                        callee = _resolveCall(n, ctx);
+                        _frameStates[top] = callee;
+                    }
+
+                    if (callee === _IF_CALL) {
+                        if (step === 0) {
+                            _frameSteps[top] = 1;
+                            _pushNode(n.args[0], ctx);
+                        } else if (_values.pop()) {
+                            _replaceFrame(top, n.args[1], ctx);
+                        } else if (n.args.length > 2) {
+                            _replaceFrame(top, n.args[2], ctx);
+                        } else {
+                            _popFrame();
+                            _values.push(0);
+                        }
+                        break;
+                    }
+
+                    if (callee.kind === 'sum' || callee.kind === 'prod') {
+                        // Steps 0 and 1 evaluate start and end, step 2 sets
+                        // up the loop (replacing the frame state), step 3
+                        // collects each term
+                        if (step < 2) {
+                            _frameSteps[top] = step + 1;
+                            _pushNode(n.args[step + 2], ctx);
+                            break;
+                        }
+                        const funcName = callee.kind;
+                        let loop = callee;
+                        if (step === 2) {
+                            const end = Math.floor(_values.pop());
+                            const start = Math.floor(_values.pop());
+                            _checkIterationRange(funcName, start, end);
+                            // Sum collects terms in iteration order for
+                            // _preciseSum; prod multiplies as it goes
+                            loop = { kind: funcName, i: start, end, context: ctx.clone(), terms: [], total: 1 };
+                            _frameStates[top] = loop;
+                            _frameSteps[top] = 3;
+                        } else if (funcName === 'sum') {
+                            loop.terms.push(_values.pop());
+                            loop.i++;
+                        } else {
+                            loop.total *= _values.pop();
+                            loop.i++;
+                        }
+                        if (loop.i <= loop.end) {
+                            loop.context.setVariable(n.args[1].name, loop.i);
+                            _pushNode(n.args[0], loop.context);
+                        } else {
+                            _popFrame();
+                            _values.push(funcName === 'sum' ? _preciseSum(loop.terms) : loop.total);
+                        }
+                        break;
+                    }
+
+                    // User function or builtin: evaluate the arguments in
+                    // the calling context (step k + 1 = k arguments done)
+                    const argc = n.args.length;
+                    const done = step === 0 ? 0 : step - 1;
+                    if (done < argc) {
+                        _frameSteps[top] = done + 2;
+                        _pushNode(n.args[done], ctx);
+                        break;
+                    }
+                    const argValues = argc > 0 ? _values.splice(_values.length - argc, argc) : [];
+                    if (typeof callee === 'function') {
+                        _popFrame();
+                        _values.push(callee(argValues, ctx));
+                        break;
+                    }
+                    if (depth >= ctx.maxCallDepth) throw _callTooDeep(n, ctx.maxCallDepth);
+                    depth++;
+                    // Function context has only constants and user functions (no variables)
+                    const funcContext = ctx.cloneForFunction();
+                    for (let i = 0; i < callee.params.length; i++) {
+                        funcContext.setVariable(callee.params[i], argValues[i] !== undefined ? argValues[i] : 0);
+                    }
+                    _frameSteps[top] = _RETURN_STEP;
+                    _pushNode(callee.body, funcContext);
+                    break;
                 }
-                if (!context.isDeclared(varName)) {
-                    throw new EvalError(`Undefined variable: ${varName}`);
+
+                case 'SHARED': {
+                    // Repeated subexpression hoisted by specializeForUnknown. Only the
+                    // solver's f(x) context carries a memo; clones (sum/prod iteration)
+                    // and function contexts evaluate the expression directly.
+                    const memo = ctx.sharedValues;
+                    if (step === 0) {
+                        if (!memo) {
+                            _replaceFrame(top, n.expr, ctx);
+                        } else if (memo[n.slot] !== undefined) {
+                            _popFrame();
+                            _values.push(memo[n.slot]);
+                        } else {
+                            _frameSteps[top] = 1;
+                            _pushNode(n.expr, ctx);
+                        }
+                    } else {
+                        _popFrame();
+                        memo[n.slot] = _values[_values.length - 1];
+                    }
+                    break;
                 }
-                return context.preSolveValues.has(varName) ? 1 : 0;
+
+                default:
+                    throw new EvalError(`Unknown node type: ${n.type}`);
             }
-            throw new EvalError(`Unknown postfix operator: ${node.op}`);
+        }
+    } catch (e) {
+        _frameNodes.length = base;
+        _frameContexts.length = base;
+        _frameSteps.length = base;
+        _frameStates.length = base;
+        _values.length = valueBase;
+        throw e;
+    }
+    return _values.pop();
+}
+
+// Outward widening applied after every interval operation: 4·EPSILON relative
+// (at least 4 ulps — covers correctly rounded arithmetic and the sub-ulp error
+// of Math.exp/log/pow) plus the smallest subnormal for results near zero.
+const INTERVAL_WIDEN = 4 * Number.EPSILON;
+
+function _interval(lo, hi) {
+    lo = lo - Math.abs(lo) * INTERVAL_WIDEN - Number.MIN_VALUE;
+    hi = hi + Math.abs(hi) * INTERVAL_WIDEN + Number.MIN_VALUE;
+    return (isFinite(lo) && isFinite(hi)) ? [lo, hi] : null;
+}
+
+function _intervalPow(a, b) {
+    if (b[0] === b[1] && Number.isInteger(b[0])) {
+        const n = b[0];
+        if (n === 0) return [1, 1];
+        if (n < 0 && a[0] <= 0 && a[1] >= 0) return null;
+        const p0 = Math.pow(a[0], n), p1 = Math.pow(a[1], n);
+        if (n % 2 === 0 && a[0] < 0 && a[1] > 0) return _interval(0, Math.max(p0, p1));
+        return _interval(Math.min(p0, p1), Math.max(p0, p1));
+    }
+    // Non-integer exponent: x**y is monotonic in each argument for x > 0,
+    // so the extremes are at the corners
+    if (a[0] <= 0) return null;
+    const c = [Math.pow(a[0], b[0]), Math.pow(a[0], b[1]), Math.pow(a[1], b[0]), Math.pow(a[1], b[1])];
+    return _interval(Math.min(...c), Math.max(...c));
+}
+
+// Builtins with interval forms: [argument count, handler]. min/max accept any count.
+const _intervalFunctions = {
+    abs: [1, ([a]) => a[0] >= 0 ? a : a[1] <= 0 ? [-a[1], -a[0]] : [0, Math.max(-a[0], a[1])]],
+    sqrt: [1, ([a]) => a[0] < 0 ? null : _interval(Math.sqrt(a[0]), Math.sqrt(a[1]))],
+    cbrt: [1, ([a]) => _interval(Math.cbrt(a[0]), Math.cbrt(a[1]))],
+    exp: [1, ([a]) => _interval(Math.exp(a[0]), Math.exp(a[1]))],
+    ln: [1, ([a]) => a[0] <= 0 ? null : _interval(Math.log(a[0]), Math.log(a[1]))],
+    log: [1, ([a]) => a[0] <= 0 ? null : _interval(Math.log10(a[0]), Math.log10(a[1]))],
+    min: [0, (args) => [Math.min(...args.map(a => a[0])), Math.min(...args.map(a => a[1]))]],
+    max: [0, (args) => [Math.max(...args.map(a => a[0])), Math.max(...args.map(a => a[1]))]]
+};
+
+/**
+ * Check whether every node in an AST has an interval form (see evaluateInterval).
+ */
+function canEvaluateInterval(node, context) {
+    if (!node) return false;
+    switch (node.type) {
+        case 'NUMBER':
+        case 'VARIABLE':
+            return true;
+        case 'SHARED':
+            return canEvaluateInterval(node.expr, context);
+        case 'UNARY_OP':
+            return (node.op === '-' || node.op === '+') && canEvaluateInterval(node.operand, context);
+        case 'BINARY_OP':
+            return ['+', '-', '*', '/', '**'].includes(node.op)
+                && canEvaluateInterval(node.left, context)
+                && canEvaluateInterval(node.right, context);
+        case 'FUNCTION_CALL': {
+            const name = node.name.toLowerCase();
+            const entry = _intervalFunctions[name];
+            if (!entry || context.userFunctions.has(name)) return false;
+            if (entry[0] ? node.args.length !== entry[0] : node.args.length === 0) return false;
+            return node.args.every(arg => canEvaluateInterval(arg, context));
+        }
+        default:
+            return false;
+    }
+}
+
+/**
+ * Interval evaluation of an AST with variable `name` ranging over [lo, hi]
+ * and every other variable at its context value. Returns [min, max]
+ * enclosing every value evaluate() can produce for such inputs (bounds are
+ * widened outward after each operation to cover floating-point rounding),
+ * or null when no finite enclosure can be established — unsupported node
+ * (see canEvaluateInterval), a possible NaN or Infinity, or division by an
+ * interval containing zero. Used by the solver to prove grid segments free
+ * of roots and poles.
+ *
+ * @param {Array} [shared] - Per-call memo for SHARED nodes
+ */
+function evaluateInterval(node, context, name, lo, hi, shared = null) {
+    if (!node) return null;
+    switch (node.type) {
+        case 'NUMBER':
+            return isFinite(node.value) ? [node.value, node.value] : null;
+
+        case 'VARIABLE': {
+            if (node.name === name) return [lo, hi];
+            const value = context.getVariable(node.name);
+            return typeof value === 'number' && isFinite(value) ? [value, value] : null;
+        }
+
+        case 'SHARED': {
+            if (shared && shared[node.slot] !== undefined) return shared[node.slot];
+            const r = evaluateInterval(node.expr, context, name, lo, hi, shared);
+            if (shared) shared[node.slot] = r;
+            return r;
+        }
+
+        case 'UNARY_OP': {
+            const a = evaluateInterval(node.operand, context, name, lo, hi, shared);
+            if (!a) return null;
+            return node.op === '-' ? [-a[1], -a[0]] : a;
         }
 
         case 'BINARY_OP': {
-            // Short-circuit evaluation for logical operators
-            if (node.op === '&&') {
-                const left = evaluate(node.left, context);
-                if (!left) return 0;
-                return evaluate(node.right, context) ? 1 : 0;
+            const a = evaluateInterval(node.left, context, name, lo, hi, shared);
+            if (!a) return null;
+            const b = evaluateInterval(node.right, context, name, lo, hi, shared);
+            if (!b) return null;
+            switch (node.op) {
+                case '+': return _interval(a[0] + b[0], a[1] + b[1]);
+                case '-': return _interval(a[0] - b[1], a[1] - b[0]);
+                case '*': {
+                    const c = [a[0] * b[0], a[0] * b[1], a[1] * b[0], a[1] * b[1]];
+                    return _interval(Math.min(...c), Math.max(...c));
+                }
+                case '/': {
+                    if (b[0] <= 0 && b[1] >= 0) return null;
+                    const c = [a[0] / b[0], a[0] / b[1], a[1] / b[0], a[1] / b[1]];
+                    return _interval(Math.min(...c), Math.max(...c));
+                }
+                case '**': return _intervalPow(a, b);
+                default: return null;
             }
-            if (node.op === '||') {
-                const left = evaluate(node.left, context);
-                if (left) return 1;
-                return evaluate(node.right, context) ? 1 : 0;
+        }
+
+        case 'FUNCTION_CALL': {
+            const entry = _intervalFunctions[node.name.toLowerCase()];
+            if (!entry) return null;
+            const args = [];
+            for (const arg of node.args) {
+                const a = evaluateInterval(arg, context, name, lo, hi, shared);
+                if (!a) return null;
+                args.push(a);
             }
+            return entry[1](args);
+        }
+
+        default:
+            return null;
+    }
+}
+
+// Element-wise operators for evaluateBatch, same arithmetic as evaluate()
+const _batchOps = {
+    '+': (l, r) => l + r,
+    '-': (l, r) => l - r,
+    '*': (l, r) => l * r,
+    '/': (l, r) => l / r,
+    '**': (l, r) => Math.pow(l, r),
+    '==': (l, r) => l === r ? 1 : 0,
+    '!=': (l, r) => l !== r ? 1 : 0,
+    '<': (l, r) => l < r ? 1 : 0,
+    '<=': (l, r) => l <= r ? 1 : 0,
+    '>': (l, r) => l > r ? 1 : 0,
+    '>=': (l, r) => l >= r ? 1 : 0
+};
 
-            const left = evaluate(node.left, context);
-            const right = evaluate(node.right, context);
+/**
+ * Check whether an AST can be evaluated by evaluateBatch. Excluded are the
+ * forms whose evaluation is lazy or per-point in evaluate() (&&, ||, if(),
+ * sum/prod iteration, user functions) and bitwise operators; what remains
+ * can only fail the same way at every point.
+ */
+function canEvaluateBatch(node, context) {
+    if (!node) return false;
+    switch (node.type) {
+        case 'NUMBER':
+        case 'VARIABLE':
+        case 'POSTFIX_OP':
+            return true;
+        case 'SHARED':
+            return canEvaluateBatch(node.expr, context);
+        case 'UNARY_OP':
+            return node.op !== '~' && canEvaluateBatch(node.operand, context);
+        case 'BINARY_OP':
+            return _batchOps[node.op] !== undefined
+                && canEvaluateBatch(node.left, context)
+                && canEvaluateBatch(node.right, context);
+        case 'FUNCTION_CALL': {
+            const name = node.name.toLowerCase();
+            if (context.userFunctions.has(name) || !builtinFunctions[name]) return false;
+            if (name === 'if' || ((name === 'sum' || name === 'prod') && node.args.length === 4)) return false;
+            return node.args.every(arg => canEvaluateBatch(arg, context));
+        }
+        default:
+            return false;
+    }
+}
 
+/**
+ * Evaluate an AST at many values of one variable in a single pass. Each node
+ * is evaluated once for the whole batch, structure-of-arrays: subtrees that
+ * don't depend on `name` stay scalars, the rest become Float64Arrays filled by
+ * a flat loop per node. Element i equals evaluate() with `name` = xs[i]; an
+ * EvalError (which for these ASTs is the same at every point) propagates.
+ * Only call on ASTs that pass canEvaluateBatch.
+ *
+ * @param {Array|Float64Array} xs - Values of `name`
+ * @param {Array} [shared] - Per-batch memo for SHARED nodes
+ * @returns {Float64Array}
+ */
+function evaluateBatch(node, context, name, xs, shared = null) {
+    const r = _evaluateBatch(node, context, name, xs, shared);
+    return typeof r === 'number' ? new Float64Array(xs.length).fill(r) : r;
+}
+
+// Number when the subtree doesn't depend on `name`, Float64Array otherwise
+function _evaluateBatch(node, context, name, xs, shared) {
+    const n = xs.length;
+    switch (node.type) {
+        case 'NUMBER':
+            return node.value;
+
+        case 'VARIABLE':
+            return node.name === name ? Float64Array.from(xs) : evaluate(node, context);
+
+        case 'POSTFIX_OP':
+            // x~ / x~? read pre-solve state, the same for every point
+            return evaluate(node, context);
+
+        case 'SHARED': {
+            if (shared && shared[node.slot] !== undefined) return shared[node.slot];
+            const r = _evaluateBatch(node.expr, context, name, xs, shared);
+            if (shared) shared[node.slot] = r;
+            return r;
+        }
+
+        case 'UNARY_OP': {
+            const a = _evaluateBatch(node.operand, context, name, xs, shared);
+            const op = node.op === '-' ? (v => -v) : node.op === '!' ? (v => v ? 0 : 1) : (v => +v);
+            if (typeof a === 'number') return op(a);
+            const out = new Float64Array(n);
+            for (let i = 0; i < n; i++) out[i] = op(a[i]);
+            return out;
+        }
+
+        case 'BINARY_OP': {
+            const l = _evaluateBatch(node.left, context, name, xs, shared);
+            const r = _evaluateBatch(node.right, context, name, xs, shared);
+            const lScalar = typeof l === 'number', rScalar = typeof r === 'number';
+            if (lScalar && rScalar) return _batchOps[node.op](l, r);
+            const out = new Float64Array(n);
+            // The common arithmetic operators get their own loops
             switch (node.op) {
-                case '+': return left + right;
-                case '-': return left - right;
-                case '*': return left * right;
+                case '+':
+                    if (lScalar) for (let i = 0; i < n; i++) out[i] = l + r[i];
+                    else if (rScalar) for (let i = 0; i < n; i++) out[i] = l[i] + r;
+                    else for (let i = 0; i < n; i++) out[i] = l[i] + r[i];
+                    return out;
+                case '-':
+                    if (lScalar) for (let i = 0; i < n; i++) out[i] = l - r[i];
+                    else if (rScalar) for (let i = 0; i < n; i++) out[i] = l[i] - r;
+                    else for (let i = 0; i < n; i++) out[i] = l[i] - r[i];
+                    return out;
+                case '*':
+                    if (lScalar) for (let i = 0; i < n; i++) out[i] = l * r[i];
+                    else if (rScalar) for (let i = 0; i < n; i++) out[i] = l[i] * r;
+                    else for (let i = 0; i < n; i++) out[i] = l[i] * r[i];
+                    return out;
                 case '/':
-                    // Allow division by zero to return Infinity/-Infinity/NaN
-                    return left / right;
-                case '**': return Math.pow(left, right);
-                case '<<': return Math.trunc(left) << Math.trunc(right);
-                case '>>': return Math.trunc(left) >> Math.trunc(right);
-                case '&': return Math.trunc(left) & Math.trunc(right);
-                case '|': return Math.trunc(left) | Math.trunc(right);
-                case '^': return Math.trunc(left) ^ Math.trunc(right);
-                case '==': return left === right ? 1 : 0;
-                case '!=': return left !== right ? 1 : 0;
-                case '<': return left < right ? 1 : 0;
-                case '<=': return left <= right ? 1 : 0;
-                case '>': return left > right ? 1 : 0;
-                case '>=': return left >= right ? 1 : 0;
-                case '^^': return (left ? 1 : 0) !== (right ? 1 : 0) ? 1 : 0; // XOR
+                    if (lScalar) for (let i = 0; i < n; i++) out[i] = l / r[i];
+                    else if (rScalar) for (let i = 0; i < n; i++) out[i] = l[i] / r;
+                    else for (let i = 0; i < n; i++) out[i] = l[i] / r[i];
+                    return out;
+                default: {
+                    const op = _batchOps[node.op];
+                    for (let i = 0; i < n; i++) out[i] = op(lScalar ? l : l[i], rScalar ? r : r[i]);
+                    return out;
+                }
+            }
+        }
+
+        case 'FUNCTION_CALL': {
+            const funcName = node.name.toLowerCase();
+            const builtin = builtinFunctions[funcName];
+            if (!builtin) throw new EvalError(`Unknown function: ${node.name}`);
+            validateArgCount(funcName, node.args.length);
+            const args = node.args.map(arg => _evaluateBatch(arg, context, name, xs, shared));
+            if (args.every(a => typeof a === 'number') && funcName !== 'rand') return builtin(args, context);
+            const out = new Float64Array(n);
+            const point = new Array(args.length);
+            for (let i = 0; i < n; i++) {
+                for (let k = 0; k < args.length; k++) point[k] = typeof args[k] === 'number' ? args[k] : args[k][i];
+                out[i] = builtin(point, context);
+            }
+            return out;
+        }
+
+        default:
+            throw new EvalError(`Unknown node type: ${node.type}`);
+    }
+}
+
+// Forward-mode derivative rules for builtins: (args, ders, value, context) → d,
+// where args are the argument values, ders their derivatives and value the
+// builtin's own result. Piecewise-constant builtins differentiate to 0.
+const _dualZero = () => 0;
+const _angleScale = (ctx) => ctx.degreesMode ? Math.PI / 180 : 1;
+const _dualFunctions = {
+    abs: ([x], [dx]) => Math.sign(x) * dx,
+    sign: _dualZero, int: _dualZero, floor: _dualZero, ceil: _dualZero, round: _dualZero,
+    frac: (args, [dx]) => dx,
+    sqrt: (args, [dx], v) => dx / (2 * v),
+    cbrt: (args, [dx], v) => dx / (3 * v * v),
+    root: ([x, n], [dx, dn], v) => v * (dx / (n * x) - dn * Math.log(x) / (n * n)),
+    exp: (args, [dx], v) => v * dx,
+    ln: ([x], [dx]) => dx / x,
+    log: ([x, b], [dx, db], v) => b === undefined ? dx / (x * Math.LN10)
+        : (dx / x - v * db / b) / Math.log(b),
+    pi: _dualZero, tau: _dualZero, perigon: _dualZero, places: _dualZero,
+    sin: ([x], [dx], v, ctx) => Math.cos(toRadians(x, ctx.degreesMode)) * _angleScale(ctx) * dx,
+    cos: ([x], [dx], v, ctx) => -Math.sin(toRadians(x, ctx.degreesMode)) * _angleScale(ctx) * dx,
+    tan: ([x], [dx], v, ctx) => {
+        const c = Math.cos(toRadians(x, ctx.degreesMode));
+        return _angleScale(ctx) * dx / (c * c);
+    },
+    asin: ([x], [dx], v, ctx) => dx / Math.sqrt(1 - x * x) / _angleScale(ctx),
+    acos: ([x], [dx], v, ctx) => -dx / Math.sqrt(1 - x * x) / _angleScale(ctx),
+    atan: ([y, x], [dy, dx], v, ctx) => (x === undefined ? dy / (1 + y * y)
+        : (x * dy - y * dx) / (x * x + y * y)) / _angleScale(ctx),
+    sinh: ([x], [dx]) => Math.cosh(x) * dx,
+    cosh: ([x], [dx]) => Math.sinh(x) * dx,
+    tanh: (args, [dx], v) => (1 - v * v) * dx,
+    asinh: ([x], [dx]) => dx / Math.sqrt(x * x + 1),
+    acosh: ([x], [dx]) => dx / Math.sqrt(x * x - 1),
+    atanh: ([x], [dx]) => dx / (1 - x * x),
+    radians: (args, [dx]) => dx * Math.PI / 180,
+    degrees: (args, [dx]) => dx * 180 / Math.PI,
+    days: (args, [da, db]) => (db - da) / 86400,
+    year: _dualZero, month: _dualZero, day: _dualZero, weekday: _dualZero,
+    hour: _dualZero, minute: _dualZero, second: _dualZero,
+    hours: (args, [dx]) => dx / 3600,
+    timepart: (args, [dx]) => dx,
+    choose: ([i], ders) => {
+        const index = Math.floor(i);
+        return index < 1 || index >= ders.length ? 0 : ders[index];
+    },
+    min: (args, ders, v) => ders[args.indexOf(v)],
+    max: (args, ders, v) => ders[args.indexOf(v)],
+    sum: (args, ders) => _preciseSum(ders),
+    avg: (args, ders) => _preciseSum(ders) / ders.length,
+    mod: ([a, b], [da, db]) => da - db * Math.floor(a / b),
+    isclose: _dualZero, modisclose: _dualZero
+};
+
+/**
+ * Check whether every node in an AST has a derivative form (see evaluateDual).
+ * User functions qualify when their bodies do and they aren't recursive:
+ * evaluateDual recurses on the JS stack, so only evaluate() can follow deep
+ * recursion. rand(), now(), date(), fact(), bitwise operators and the
+ * sum/prod iteration forms don't qualify either.
+ */
+function canEvaluateDual(node, context, visiting = new Set()) {
+    if (!node) return false;
+    switch (node.type) {
+        case 'NUMBER':
+        case 'VARIABLE':
+            return true;
+        case 'POSTFIX_OP':
+            return node.op === '~' || node.op === '?';
+        case 'SHARED':
+            return canEvaluateDual(node.expr, context, visiting);
+        case 'UNARY_OP':
+            return node.op !== '~' && canEvaluateDual(node.operand, context, visiting);
+        case 'BINARY_OP':
+            return !['<<', '>>', '&', '|', '^'].includes(node.op)
+                && canEvaluateDual(node.left, context, visiting)
+                && canEvaluateDual(node.right, context, visiting);
+        case 'FUNCTION_CALL': {
+            const name = node.name.toLowerCase();
+            const userFunc = context.userFunctions.get(name);
+            if (userFunc) {
+                if (visiting.has(name)) return false;
+                visiting.add(name);
+                const ok = canEvaluateDual(userFunc.body, context, visiting);
+                visiting.delete(name);
+                if (!ok) return false;
+            } else if (name !== 'if' && !_dualFunctions[name]) {
+                return false;
+            } else if (name === 'sum' && node.args.length === 4) {
+                return false;
+            }
+            return node.args.every(arg => canEvaluateDual(arg, context, visiting));
+        }
+        default:
+            return false;
+    }
+}
+
+/**
+ * Forward-mode automatic differentiation: evaluate an AST on dual numbers.
+ * `bindings` maps variable names to [value, derivative] pairs (the unknown
+ * as [x, 1]); every other variable is a constant from the context. Returns
+ * [value, derivative] where value matches evaluate() for the same inputs.
+ * Throws EvalError where evaluate() would. Only call on ASTs that pass
+ * canEvaluateDual. Used by the solver's Newton steps inside Brent's bracket.
+ *
+ * @param {Array} [shared] - Per-call memo for SHARED nodes
+ */
+function evaluateDual(node, context, bindings, shared = null) {
+    if (node === null) return [0, 0];
+    switch (node.type) {
+        case 'NUMBER':
+            return [node.value, 0];
+
+        case 'VARIABLE': {
+            const bound = bindings.get(node.name);
+            if (bound) return bound;
+            const value = context.getVariable(node.name);
+            if (value === undefined) throw new EvalError(`Undefined variable: ${node.name}`);
+            return [value, 0];
+        }
+
+        case 'POSTFIX_OP':
+            // x~ and x~? read pre-solve state, which the unknown doesn't change
+            return [evaluate(node, context), 0];
+
+        case 'SHARED': {
+            if (shared && shared[node.slot] !== undefined) return shared[node.slot];
+            const r = evaluateDual(node.expr, context, bindings, shared);
+            if (shared) shared[node.slot] = r;
+            return r;
+        }
+
+        case 'UNARY_OP': {
+            const [v, d] = evaluateDual(node.operand, context, bindings, shared);
+            switch (node.op) {
+                case '-': return [-v, -d];
+                case '+': return [+v, d];
+                case '!': return [v ? 0 : 1, 0];
+                default:
+                    throw new EvalError(`Unknown unary operator: ${node.op}`);
+            }
+        }
+
+        case 'BINARY_OP': {
+            if (node.op === '&&' || node.op === '||') {
+                const [l] = evaluateDual(node.left, context, bindings, shared);
+                if (node.op === '&&' ? !l : l) return [node.op === '&&' ? 0 : 1, 0];
+                const [r] = evaluateDual(node.right, context, bindings, shared);
+                return [r ? 1 : 0, 0];
+            }
+            const [l, dl] = evaluateDual(node.left, context, bindings, shared);
+            const [r, dr] = evaluateDual(node.right, context, bindings, shared);
+            switch (node.op) {
+                case '+': return [l + r, dl + dr];
+                case '-': return [l - r, dl - dr];
+                case '*': return [l * r, dl * r + l * dr];
+                case '/': return [l / r, (dl * r - l * dr) / (r * r)];
+                case '**': {
+                    const v = Math.pow(l, r);
+                    // Constant exponent: power rule (also valid for l ≤ 0)
+                    const d = dr === 0 ? (dl === 0 ? 0 : r * Math.pow(l, r - 1) * dl)
+                        : v * (dr * Math.log(l) + (dl === 0 ? 0 : r * dl / l));
+                    return [v, d];
+                }
+                case '==': return [l === r ? 1 : 0, 0];
+                case '!=': return [l !== r ? 1 : 0, 0];
+                case '<': return [l < r ? 1 : 0, 0];
+                case '<=': return [l <= r ? 1 : 0, 0];
+                case '>': return [l > r ? 1 : 0, 0];
+                case '>=': return [l >= r ? 1 : 0, 0];
+                case '^^': return [(l ? 1 : 0) !== (r ? 1 : 0) ? 1 : 0, 0];
                 default:
                     throw new EvalError(`Unknown binary operator: ${node.op}`);
             }
@@ -722,90 +1747,38 @@ function evaluate(node, context) {
         case 'FUNCTION_CALL': {
             const funcName = node.name.toLowerCase();
 
-            // Check for user-defined function first
             const userFunc = context.getUserFunction(funcName);
             if (userFunc) {
                 const expected = userFunc.params.length;
                 if (node.args.length !== expected) {
                     throw new EvalError(`${node.name}() requires ${expected} argument${expected !== 1 ? 's' : ''}, got ${node.args.length}`);
                 }
-                // Evaluate arguments in the calling context
-                const argValues = node.args.map(arg => evaluate(arg, context));
-
-                // Create function context with only constants and user functions (no variables)
-                const funcContext = context.cloneForFunction();
-                for (let i = 0; i < userFunc.params.length; i++) {
-                    funcContext.setVariable(userFunc.params[i], argValues[i] !== undefined ? argValues[i] : 0);
+                const params = new Map();
+                for (let i = 0; i < expected; i++) {
+                    params.set(userFunc.params[i], evaluateDual(node.args[i], context, bindings, shared));
                 }
-
-                // Evaluate function body
-                return evaluate(userFunc.body, funcContext);
+                return evaluateDual(userFunc.body, context.cloneForFunction(), params);
             }
 
-            // Special handling for 'if' - lazy evaluation to support recursion
             if (funcName === 'if') {
                 validateArgCount(funcName, node.args.length);
-                const condition = evaluate(node.args[0], context);
-                if (condition) {
-                    return evaluate(node.args[1], context);
-                } else {
-                    return node.args.length > 2 ? evaluate(node.args[2], context) : 0;
-                }
-            }
-
-            // Binding-variable iteration forms: sum(expr; var; start; end)
-            // and prod(expr; var; start; end). Identical except for the
-            // accumulator identity and operation.
-            if (funcName === 'sum' || funcName === 'prod') {
-                if (node.args.length !== 4) {
-                    throw new EvalError(`${funcName}() requires 4 arguments: ${funcName}(expr; var; start; end)`);
-                }
-                const exprNode = node.args[0];
-                const varNode = node.args[1];
-                if (varNode.type !== 'VARIABLE') {
-                    throw new EvalError(`${funcName}() second argument must be a variable name`);
-                }
-                const varName = varNode.name;
-                const start = Math.floor(evaluate(node.args[2], context));
-                const end = Math.floor(evaluate(node.args[3], context));
-
-                if (!isFinite(start) || !isFinite(end)) {
-                    throw new EvalError(`${funcName}() start and end must be finite numbers`);
-                }
-                const iterations = end - start + 1;
-                if (iterations > 10000000) {
-                    throw new EvalError(`${funcName}() too many iterations (${iterations}). Max is 10,000,000`);
-                }
-
-                const isSum = funcName === 'sum';
-                const iterContext = context.clone();
-                if (isSum) {
-                    // Collect terms in iteration order, then sum (precise when
-                    // available; reduce() otherwise — identical to the old loop).
-                    const terms = [];
-                    for (let i = start; i <= end; i++) {
-                        iterContext.setVariable(varName, i);
-                        terms.push(evaluate(exprNode, iterContext));
-                    }
-                    return _preciseSum(terms);
-                }
-                let total = 1;
-                for (let i = start; i <= end; i++) {
-                    iterContext.setVariable(varName, i);
-                    total *= evaluate(exprNode, iterContext);
-                }
-                return total;
+                const [condition] = evaluateDual(node.args[0], context, bindings, shared);
+                if (condition) return evaluateDual(node.args[1], context, bindings, shared);
+                return node.args.length > 2 ? evaluateDual(node.args[2], context, bindings, shared) : [0, 0];
             }
 
-            // Check built-in functions
             const builtin = builtinFunctions[funcName];
-            if (builtin) {
-                validateArgCount(funcName, node.args.length);
-                const argValues = node.args.map(arg => evaluate(arg, context));
-                return builtin(argValues, context);
+            const rule = _dualFunctions[funcName];
+            if (!builtin || !rule) throw new EvalError(`Unknown function: ${node.name}`);
+            validateArgCount(funcName, node.args.length);
+            const args = [], ders = [];
+            for (const arg of node.args) {
+                const [v, d] = evaluateDual(arg, context, bindings, shared);
+                args.push(v);
+                ders.push(d);
             }
-
-            throw new EvalError(`Unknown function: ${node.name}`);
+            const value = builtin(args, context);
+            return [value, rule(args, ders, value, context)];
         }
 
         default:
@@ -820,17 +1793,125 @@ function evaluate(node, context) {
  * Number('0.075e2') parses directly to 7.5 (exact), avoiding the multiplication error.
  */
 function toFixed(value, places) {
+    const fast = _toFixedShortest(value, places);
+    if (fast !== null) return fast;
     const rounded = Number(Math.round(Number(value + 'e' + places)) + 'e-' + places);
     return isFinite(rounded) ? rounded.toFixed(places) : value.toFixed(places);
 }
 
+/**
+ * toFixed fast path: round the shortest round-trip decimal string of value
+ * (String(value)) directly, with Math.round's ties-toward-+Infinity rule.
+ * Only taken when that string has at most 15 significant digits and the
+ * rounded result at most 15 digits — then the exponent shift above is exact
+ * (no double can land on a .5 tie it isn't) and rounded.toFixed() prints the
+ * rounded decimal verbatim, so both paths return the same string. Returns
+ * null when the general path is needed (exponent form, long digit strings).
+ */
+function _toFixedShortest(value, places) {
+    if (!(places >= 0 && places <= 20) || places !== Math.floor(places)) return null;
+    const s = String(value);
+    if (s.length > 22 || s.indexOf('e') !== -1 || s.indexOf('N') !== -1 || s.indexOf('I') !== -1) return null;
+    const neg = s.charCodeAt(0) === 45; // '-'
+    const start = neg ? 1 : 0;
+    const dot = s.indexOf('.');
+    const intEnd = dot === -1 ? s.length : dot;
+    const fracStart = dot === -1 ? s.length : dot + 1;
+    const fracLen = s.length - fracStart;
+
+    // Significant digits of the input
+    let first = start;
+    while (first < intEnd - 1 && s.charCodeAt(first) === 48) first++;
+    let sig = intEnd - first + fracLen;
+    if (intEnd - first === 1 && s.charCodeAt(first) === 48) {
+        // 0.000ddd: leading fraction zeros aren't significant
+        let f = fracStart;
+        while (f < s.length && s.charCodeAt(f) === 48) f++;
+        sig = s.length - f;
+    }
+    if (sig > 15) return null;
+
+    // Kept digits: integer part plus `places` fraction digits (zero padded)
+    const digits = [];
+    for (let i = first; i < intEnd; i++) digits.push(s.charCodeAt(i) - 48);
+    for (let i = 0; i < places; i++) {
+        digits.push(i < fracLen ? s.charCodeAt(fracStart + i) - 48 : 0);
+    }
+
+    // Round on the dropped tail. Shortest strings have no trailing zeros, so
+    // a tail of exactly "5" is the only tie.
+    if (fracLen > places) {
+        const d = s.charCodeAt(fracStart + places) - 48;
+        const aboveHalf = d > 5 || (d === 5 && fracLen > places + 1);
+        const tie = d === 5 && fracLen === places + 1;
+        if (aboveHalf || (tie && !neg)) {
+            let i = digits.length - 1;
+            while (i >= 0 && digits[i] === 9) digits[i--] = 0;
+            if (i >= 0) digits[i]++;
+            else digits.unshift(1);
+        }
+    }
+
+    const intLen = digits.length - places;
+    let lead = 0;
+    while (lead < intLen - 1 && digits[lead] === 0) lead++;
+    if (digits.length - lead > 15) return null;
+    let allZero = true;
+    for (let i = lead; i < digits.length; i++) {
+        if (digits[i] !== 0) { allZero = false; break; }
+    }
+    let out = neg && !allZero ? '-' : '';
+    for (let i = lead; i < intLen; i++) out += digits[i];
+    if (places > 0) {
+        out += '.';
+        for (let i = intLen; i < digits.length; i++) out += digits[i];
+    }
+    return out;
+}
+
+function _isDigitCode(c) {
+    return c >= 48 && c <= 57;
+}
+
+function _isWordCode(c) {
+    return _isDigitCode(c) || (c >= 65 && c <= 90) || (c >= 97 && c <= 122) || c === 95;
+}
+
 /**
  * Add comma grouping to integer part of a numeric string: 1234567.89 -> 1,234,567.89
+ * Single pass; inserts a comma wherever /\B(?=(\d{3})+(?!\d))/ would — before
+ * a digit preceded by a word character whose digit run to its end is a
+ * multiple of three long.
  */
 function addCommaGrouping(numStr) {
-    const parts = numStr.split('.');
-    parts[0] = parts[0].replace(/\B(?=(\d{3})+(?!\d))/g, ',');
-    return parts.join('.');
+    const dot = numStr.indexOf('.');
+    const intPart = dot === -1 ? numStr : numStr.substring(0, dot);
+    let out = '';
+    let runEnd = -1;
+    for (let i = 0; i < intPart.length; i++) {
+        const c = intPart.charCodeAt(i);
+        if (_isDigitCode(c)) {
+            if (runEnd < i) {
+                runEnd = i;
+                while (runEnd < intPart.length && _isDigitCode(intPart.charCodeAt(runEnd))) runEnd++;
+            }
+            if (i > 0 && (runEnd - i) % 3 === 0 && _isWordCode(intPart.charCodeAt(i - 1))) out += ',';
+        }
+        out += intPart[i];
+    }
+    return dot === -1 ? out : out + numStr.substring(dot);
+}
+
+/**
+ * Strip trailing fraction zeros and a bare trailing point: 1.500 -> 1.5,
+ * 10.00 -> 10. Strings without a decimal point are returned unchanged.
+ */
+function _stripFractionZeros(str) {
+    if (str.indexOf('.') === -1) return str;
+    let end = str.length;
+    while (end > 0 && str.charCodeAt(end - 1) === 48) end--;
+    if (end > 0 && str.charCodeAt(end - 1) === 46) end--;
+    return end === str.length ? str : str.substring(0, end);
 }
 
 /**
@@ -858,7 +1939,7 @@ function formatMoney(value, symbol) {
 function formatPercent(value, places, stripZeros = true) {
     const percent = value * 100;
     let formatted = toFixed(percent, places);
-    if (stripZeros) formatted = formatted.replace(/(\.\d*?)0+$/, '$1').replace(/\.$/, '');
+    if (stripZeros) formatted = _stripFractionZeros(formatted);
     return formatted + '%';
 }
 
@@ -868,7 +1949,7 @@ function formatPercent(value, places, stripZeros = true) {
 function formatDegrees(value, places, degreesMode = true) {
     const M = degreesMode ? 360 : 2 * Math.PI;
     const normalized = value - M * Math.floor(value / M);
-    const formatted = toFixed(normalized, places).replace(/(\.\d*?)0+$/, '$1').replace(/\.$/, '');
+    const formatted = _stripFractionZeros(toFixed(normalized, places));
     return degreesMode ? formatted + '°' : formatted;
 }
 
@@ -943,9 +2024,9 @@ function formatNumber(value, places = 14, stripZeros = true, format = 'float', b
         if (str.includes('e')) {
             // Strip zeros from mantissa before the 'e'
             const eIdx = str.indexOf('e');
-            str = str.substring(0, eIdx).replace(/\.?0+$/, '') + str.substring(eIdx);
+            str = _stripFractionZeros(str.substring(0, eIdx)) + str.substring(eIdx);
         } else {
-            str = str.replace(/\.?0+$/, '');
+            str = _stripFractionZeros(str);
         }
     }
 
@@ -960,7 +2041,7 @@ function formatNumber(value, places = 14, stripZeros = true, format = 'float', b
 // Export for use in other modules
 if (typeof module !== 'undefined' && module.exports) {
     module.exports = {
-        EvalContext, EvalError, evaluate, formatNumber, addCommaGrouping, formatMoney, formatPercent, formatDegrees, parseDateText, formatDateValue, parseDurationText, formatDuration, toFixed, checkBalance, modNormalize, modCheckBalance,
+        EvalContext, EvalError, CallDepthError, MAX_CALL_DEPTH, evaluate, evaluateInterval, canEvaluateInterval, evaluateDual, canEvaluateDual, evaluateBatch, canEvaluateBatch, formatNumber, addCommaGrouping, formatMoney, formatPercent, formatDegrees, parseDateText, formatDateValue, parseDurationText, formatDuration, toFixed, checkBalance, modNormalize, modCheckBalance,
         builtinFunctions, factorial, gamma, currencyPlaces, suffixCurrencies
     };
 }
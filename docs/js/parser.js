@@ -381,10 +381,7 @@ class Tokenizer {
             // Check if preceded by an operator — always a base literal in expression context
             // Exception: \ (inline eval delimiter) is not expression context
             const lastToken = this.tokens.length > 0 ? this.tokens[this.tokens.length - 1] : null;
-            if (lastToken && (lastToken.type === TokenType.OPERATOR && lastToken.value !== '\\' ||
-                              lastToken.type === TokenType.LPAREN ||
-                              lastToken.type === TokenType.SEMICOLON ||
-                              lastToken.type === TokenType.COMMA)) {
+            if (lastToken && _isExpressionContext(lastToken)) {
                 isBaseLiteral = true;
             } else {
                 // Peek past #digits + optional whitespace for a declaration marker
@@ -994,15 +991,136 @@ class ParseError extends Error {
  * High-level parsing functions
  */
 
+// Content-addressed parse cache. Between solves a record's text is mostly
+// unchanged (output values differ, and those are cleared before solving), so
+// line tokens and expression ASTs are cached by their source text and shared.
+// Tokens and ASTs are never mutated after parsing: cached ones are frozen,
+// so a write throws in strict code instead of corrupting every later parse
+// of the same text. Bounded, least recently used evicted.
+const PARSE_CACHE_LIMIT = 5000;
+const _lineTokenCache = new Map();   // line text → { line, tokens } (tokens end with EOF)
+const _expressionCache = new Map();  // expression text → AST
+const _parseCacheStats = { lineHits: 0, lineMisses: 0, expressionHits: 0, expressionMisses: 0 };
+
+function cacheGet(cache, key) {
+    const value = cache.get(key);
+    if (value !== undefined) {
+        cache.delete(key); // refresh recency
+        cache.set(key, value);
+    }
+    return value;
+}
+
+function cacheSet(cache, key, value) {
+    if (cache.size >= PARSE_CACHE_LIMIT) cache.delete(cache.keys().next().value);
+    cache.set(key, value);
+}
+
+// Freeze a cached token array and its tokens
+function _freezeTokens(tokens) {
+    for (const t of tokens) Object.freeze(t);
+    return Object.freeze(tokens);
+}
+
+// Freeze a cached AST, every node and array in it
+function _freezeAST(node) {
+    if (node === null || typeof node !== 'object' || Object.isFrozen(node)) return node;
+    for (const key of Object.keys(node)) _freezeAST(node[key]);
+    return Object.freeze(node);
+}
+
+// A token after which name#digits is a base literal (see Tokenizer.tokenizeIdentifier)
+function _isExpressionContext(token) {
+    return token.type === TokenType.OPERATOR && token.value !== '\\' ||
+        token.type === TokenType.LPAREN ||
+        token.type === TokenType.SEMICOLON ||
+        token.type === TokenType.COMMA;
+}
+
+/**
+ * Tokenize text into per-line token arrays (Token[][], EOF on the last line),
+ * reusing the cached tokens of lines seen before. A line's tokens depend only
+ * on its own text, with two exceptions where the text is tokenized whole: a
+ * "comment" spanning lines (an odd number of quotes on the line where it
+ * opens), and a line starting with name#digits after a line ending in an
+ * operator, ( ; or , (the Tokenizer reads it as a base literal there).
+ */
 function tokenize(text) {
-    const tokenizer = new Tokenizer(text);
-    return tokenizer.tokenize();
+    const sourceLines = text.split('\n');
+    if (sourceLines.some(line => line.includes('"') && line.split('"').length % 2 === 0)) {
+        return new Tokenizer(text).tokenize();
+    }
+    const lines = _tokenizeLines(sourceLines);
+    let prevToken = null;
+    for (let i = 0; i < lines.length; i++) {
+        if (prevToken && _isExpressionContext(prevToken) && /^\s*\w+#\d/.test(sourceLines[i])) {
+            return new Tokenizer(text).tokenize();
+        }
+        const tokens = lines[i];
+        const n = i === lines.length - 1 ? tokens.length - 1 : tokens.length; // skip EOF
+        if (n > 0) prevToken = tokens[n - 1];
+    }
+    return lines;
+}
+
+function _tokenizeLines(sourceLines) {
+    const last = sourceLines.length - 1;
+    return sourceLines.map((lineText, i) => {
+        let entry = cacheGet(_lineTokenCache, lineText);
+        if (entry) {
+            _parseCacheStats.lineHits++;
+        } else {
+            _parseCacheStats.lineMisses++;
+            entry = { line: 1, tokens: _freezeTokens(new Tokenizer(lineText).tokenize()[0]) };
+            cacheSet(_lineTokenCache, lineText, entry);
+        }
+        // Token positions are absolute: rebase onto this line when it differs
+        // (kept rebased, so a line that stays put is shared without copying)
+        let tokens = entry.tokens;
+        if (entry.line !== i + 1) {
+            tokens = entry.tokens = _freezeTokens(tokens.map(t => ({ ...t, line: i + 1 })));
+            entry.line = i + 1;
+        }
+        return i === last ? tokens : tokens.slice(0, -1);
+    });
 }
 
 function parseExpression(text) {
+    let ast = cacheGet(_expressionCache, text);
+    if (ast !== undefined) {
+        _parseCacheStats.expressionHits++;
+        return ast;
+    }
+    _parseCacheStats.expressionMisses++;
     const lines = tokenize(text);
     const parser = new Parser(lines.flat());
-    return parser.parse();
+    ast = _freezeAST(parser.parse());
+    cacheSet(_expressionCache, text, ast);
+    return ast;
+}
+
+/**
+ * Parse cache hit counts and rates since the last reset
+ * @returns {{ lines: { hits, misses, hitRate }, expressions: { hits, misses, hitRate } }}
+ */
+function parseCacheStats() {
+    const rate = (hits, misses) => ({ hits, misses, hitRate: hits + misses > 0 ? hits / (hits + misses) : 0 });
+    return {
+        lines: rate(_parseCacheStats.lineHits, _parseCacheStats.lineMisses),
+        expressions: rate(_parseCacheStats.expressionHits, _parseCacheStats.expressionMisses)
+    };
+}
+
+function resetParseCacheStats() {
+    for (const key in _parseCacheStats) _parseCacheStats[key] = 0;
+}
+
+/**
+ * Drop all cached line tokens and expression ASTs (hit counts are kept)
+ */
+function clearParseCache() {
+    _lineTokenCache.clear();
+    _expressionCache.clear();
 }
 
 function parseTokens(tokens) {
@@ -1015,6 +1133,7 @@ if (typeof module !== 'undefined' && module.exports) {
     module.exports = {
         VarType, ClearBehavior,
         TokenType, NodeType, Tokenizer, Parser, ParseError,
-        tokenize, parseExpression, parseTokens, findLineCommentStart
+        tokenize, parseExpression, parseTokens, findLineCommentStart,
+        parseCacheStats, resetParseCacheStats, clearParseCache
     };
 }
@@ -93,15 +93,181 @@ function evalLimitRange(limits, context, withStep = false) {
     return range;
 }
 
+/**
+ * Cross-record root cache. Records built from the same template solve the
+ * same equations with the same inputs over and over, so the roots of each
+ * single-unknown solve are kept in a bounded LRU keyed by the exact problem:
+ * the equation after substitution (canonical astKey), the target, the exact
+ * value of every other variable it reads, the evaluated limits, the °= modulus,
+ * angle mode, places(), the warm-start guess (it can decide which root the
+ * fallback finds), and the body of every user function it calls along with
+ * the constants those bodies read. Equations calling rand()/now() or reading
+ * pre-solve values (x~) are never cached, and neither are timeouts.
+ *
+ * An entry holds the roots in preference order as far as any caller has
+ * consumed them (`done` once the sequence ran out), or the solve's error.
+ * JavaScript runs each page or worker single-threaded, so readers never see
+ * an entry mid-update; every worker has its own cache.
+ */
+const ROOT_CACHE_LIMIT = 2000;
+const _rootCache = new Map(); // problem key → { roots, done, error }
+const _rootCacheStats = { hits: 0, misses: 0 };
+const _functionKeys = new WeakMap(); // user function entry → { key, calls, vars, cacheable }
+
+// Walk an AST for what a root cache key depends on beyond its structure:
+// function names called, and whether it reads pre-solve values
+function _scanForRootCache(node, info) {
+    if (!node || typeof node !== 'object') return info;
+    if (node.type === 'FUNCTION_CALL') info.calls.add(node.name.toLowerCase());
+    else if (node.type === 'POSTFIX_OP') info.cacheable = false;
+    for (const key in node) {
+        const child = node[key];
+        if (child && typeof child === 'object') _scanForRootCache(child, info);
+    }
+    return info;
+}
+
+// Exact, round-trippable text for a variable value; null if it has none
+function _valueKey(value) {
+    if (typeof value === 'number') return Object.is(value, -0) ? '-0' : String(value);
+    if (Array.isArray(value)) {
+        const parts = value.map(_valueKey);
+        return parts.includes(null) ? null : '[' + parts.join(',') + ']';
+    }
+    return null;
+}
+
+/**
+ * Root cache key for solving `leftAST = rightAST` for `unknown`, or null when
+ * the problem can't be cached. Marks the user functions it calls, and the
+ * constants they read, as used — a cache hit never evaluates them, and the
+ * References section must not depend on whether the roots came from the cache.
+ */
+function rootCacheKey(leftAST, rightAST, unknown, allVars, context, limits, modN, guess) {
+    const VOLATILE_FNS = new Set(['rand', 'now']);
+    const info = _scanForRootCache(rightAST, _scanForRootCache(leftAST, { calls: new Set(), cacheable: true }));
+    if (!info.cacheable) return null;
+
+    const parts = [astKey(leftAST) + '=' + astKey(rightAST), unknown];
+    for (const v of [...allVars].sort()) {
+        if (v === unknown) continue;
+        const value = _valueKey(context.getVariable(v));
+        if (value === null) return null;
+        parts.push(v + '=' + value);
+    }
+
+    // User functions, transitively: bodies and the constants they read
+    const functions = [];
+    const bodyVars = new Set();
+    const pending = [...info.calls];
+    const seen = new Set(pending);
+    while (pending.length > 0) {
+        const name = pending.pop();
+        const func = context.userFunctions.get(name);
+        if (!func) {
+            if (VOLATILE_FNS.has(name)) return null;
+            continue;
+        }
+        let fk = _functionKeys.get(func);
+        if (!fk) {
+            const bodyInfo = _scanForRootCache(func.body, { calls: new Set(), cacheable: true });
+            const params = new Set(func.params);
+            fk = {
+                key: name + '(' + func.params.join(',') + ')=' + astKey(func.body),
+                calls: bodyInfo.calls,
+                vars: [...findVariablesInAST(func.body)].filter(v => !params.has(v)),
+                cacheable: bodyInfo.cacheable
+            };
+            _functionKeys.set(func, fk);
+        }
+        if (!fk.cacheable) return null;
+        functions.push(name);
+        parts.push(fk.key);
+        for (const v of fk.vars) bodyVars.add(v);
+        for (const c of fk.calls) {
+            if (!seen.has(c)) {
+                seen.add(c);
+                pending.push(c);
+            }
+        }
+    }
+    // Function bodies see constants only (cloneForFunction)
+    for (const v of [...bodyVars].sort()) {
+        const value = context.constants.has(v) ? _valueKey(context.constants.get(v)) : '_';
+        if (value === null) return null;
+        parts.push('@' + v + '=' + value);
+    }
+
+    parts.push(limits ? 'L' + _valueKey(limits.low) + ':' + _valueKey(limits.high) +
+        (limits.step !== undefined ? ':' + _valueKey(limits.step) : '') : 'L');
+    parts.push('M' + (modN === null ? '' : _valueKey(modN)), context.degreesMode ? 'deg' : 'rad',
+        'P' + context.places, 'G' + (guess === null ? '' : _valueKey(guess)));
+
+    for (const name of functions) context.usedFunctions.add(name);
+    for (const v of bodyVars) if (context.constants.has(v)) context.usedConstants.add(v);
+    return parts.join('\n');
+}
+
+function rootCacheGet(key) {
+    const entry = _rootCache.get(key);
+    if (entry === undefined) {
+        _rootCacheStats.misses++;
+        return null;
+    }
+    _rootCache.delete(key); // refresh recency
+    _rootCache.set(key, entry);
+    _rootCacheStats.hits++;
+    return entry;
+}
+
+function rootCacheSet(key, entry) {
+    if (_rootCache.size >= ROOT_CACHE_LIMIT) _rootCache.delete(_rootCache.keys().next().value);
+    _rootCache.set(key, entry);
+}
+
+/**
+ * Roots of a cache entry in preference order: the ones already recorded,
+ * then — only if a caller wants more — the rest from solve() (a fresh
+ * allRoots solve in the same state), recording them as they come.
+ */
+function* cachedRoots(entry, solve) {
+    let n = 0;
+    for (; n < entry.roots.length; n++) yield entry.roots[n];
+    if (entry.done) return;
+    let i = 0;
+    for (const root of solve()) {
+        if (i++ < n) continue;
+        if (entry.roots.length < i) entry.roots.push(root);
+        n++;
+        yield root;
+    }
+    entry.done = true;
+}
+
+function rootCacheStats() {
+    const { hits, misses } = _rootCacheStats;
+    return { hits, misses, size: _rootCache.size, hitRate: hits + misses > 0 ? hits / (hits + misses) : 0 };
+}
+
+function clearRootCache() {
+    _rootCache.clear();
+    for (const key in _rootCacheStats) _rootCacheStats[key] = 0;
+}
+
 /**
  * Solve a single equation in context
  *
  * @param {Object} [options] - { allRoots: boolean }. When true, returns all Brent's roots
- *                             in preference order (result.values array) instead of just
- *                             the single best root (result.value). Used by the recursive
- *                             solver to enumerate candidates for backtracking.
+ *                             in preference order (result.values, a lazily-refined
+ *                             iterable) instead of just the single best root
+ *                             (result.value). Used by the recursive solver to enumerate
+ *                             candidates for backtracking; it may consume the iterable
+ *                             across branches, since restoreState brings the context
+ *                             back to the state the roots were scanned in.
+ *                             cancel: SolveCancelToken checked inside Brent's; its
+ *                             SolveTimeoutError propagates to the caller.
  */
-function solveEquationInContext(eqLine, context, variables, substitutions = new Map(), modN = null, leftAST, rightAST, { allRoots = false } = {}) {
+function solveEquationInContext(eqLine, context, variables, substitutions = new Map(), modN = null, leftAST, rightAST, { allRoots = false, cancel = null } = {}) {
     if (!leftAST || !rightAST) {
         return { solved: false };
     }
@@ -173,47 +339,139 @@ function solveEquationInContext(eqLine, context, variables, substitutions = new
         }
     }
 
-    // Create equation function: f(x) = left - right = 0
-    const f = (x) => {
-        const ctx = context.clone();
-        ctx.setVariable(unknown, x);
-        try {
-            const leftVal = evaluate(leftAST, ctx);
-            const rightVal = evaluate(rightAST, ctx);
-            let diff = leftVal - rightVal;
-            if (modN) diff -= modN * Math.round(diff / modN);
-            return diff;
-        } catch (e) {
-            return NaN;
+    // Warm start from the unknown's pre-solve value (the previous solve's
+    // result, or the previous row's in a table)
+    const previous = context.preSolveValues ? context.preSolveValues.get(unknown) : undefined;
+    const guess = typeof previous === 'number' && isFinite(previous) ? previous : null;
+
+    // Run Brent's on the equation; everything below is per-solve setup
+    function solveTarget(wantAllRoots) {
+        // Create equation function: f(x) = left - right = 0, evaluated on ASTs
+        // with the known subtrees folded and repeated subexpressions shared
+        const target = specializeForUnknown(leftAST, rightAST, unknown, context);
+        const stats = _profile !== null ? _profileEntry(eqLine, unknown) : null;
+        if (stats) stats.solves++;
+        const f = (x) => {
+            if (stats) stats.evals++;
+            const ctx = context.clone();
+            ctx.setVariable(unknown, x);
+            if (target.sharedCount > 0) ctx.sharedValues = new Array(target.sharedCount);
+            try {
+                const leftVal = evaluate(target.leftAST, ctx);
+                const rightVal = evaluate(target.rightAST, ctx);
+                let diff = leftVal - rightVal;
+                if (modN) diff -= modN * Math.round(diff / modN);
+                return diff;
+            } catch (e) {
+                return NaN;
+            }
+        };
+
+        // Compute scale hint from known variable magnitudes for search range
+        let knownScale = 0;
+        for (const v of allVars) {
+            if (v !== unknown && context.hasVariable(v)) {
+                const val = Math.abs(context.getVariable(v));
+                if (isFinite(val)) knownScale = Math.max(knownScale, val);
+            }
         }
-    };
 
-    // Compute scale hint from known variable magnitudes for search range
-    let knownScale = 0;
-    for (const v of allVars) {
-        if (v !== unknown && context.hasVariable(v)) {
-            const val = Math.abs(context.getVariable(v));
-            if (isFinite(val)) knownScale = Math.max(knownScale, val);
+        // Interval enclosure of the residual, used to skip grid segments of a
+        // limits scan that provably hold no root
+        let intervalF = null;
+        if (limits && !modN && canEvaluateInterval(target.leftAST, context) && canEvaluateInterval(target.rightAST, context)) {
+            const residual = { type: 'BINARY_OP', op: '-', left: target.leftAST, right: target.rightAST };
+            intervalF = (lo, hi) => evaluateInterval(residual, context, unknown, lo, hi,
+                target.sharedCount > 0 ? new Array(target.sharedCount) : null);
+        }
+
+        // Residual and its derivative in one pass (forward-mode AD), for Newton
+        // steps inside Brent's bracket. Not for °= equations: the wrapped residual
+        // jumps where the derivative doesn't see it.
+        let derivativeF = null;
+        if (!modN && canEvaluateDual(target.leftAST, context) && canEvaluateDual(target.rightAST, context)) {
+            derivativeF = (x) => {
+                if (stats) stats.evals++;
+                const bindings = new Map([[unknown, [x, 1]]]);
+                const shared = target.sharedCount > 0 ? new Array(target.sharedCount) : null;
+                try {
+                    const [leftVal, leftDer] = evaluateDual(target.leftAST, context, bindings, shared);
+                    const [rightVal, rightDer] = evaluateDual(target.rightAST, context, bindings, shared);
+                    return [leftVal - rightVal, leftDer - rightDer];
+                } catch (e) {
+                    return [NaN, NaN];
+                }
+            };
+        }
+
+        // Residual at a whole scan grid in one pass (structure-of-arrays), for
+        // the solver's grid scans and probe batches
+        let batchF = null;
+        if (canEvaluateBatch(target.leftAST, context) && canEvaluateBatch(target.rightAST, context)) {
+            batchF = (xs) => {
+                if (stats) stats.evals += xs.length;
+                const shared = target.sharedCount > 0 ? new Array(target.sharedCount) : null;
+                let out;
+                try {
+                    out = evaluateBatch(target.leftAST, context, unknown, xs, shared);
+                    const right = evaluateBatch(target.rightAST, context, unknown, xs, shared);
+                    for (let i = 0; i < out.length; i++) {
+                        let diff = out[i] - right[i];
+                        if (modN) diff -= modN * Math.round(diff / modN);
+                        out[i] = diff;
+                    }
+                } catch (e) {
+                    return new Float64Array(xs.length).fill(NaN);
+                }
+                return out;
+            };
+        }
+
+        // Solve — pass modN so solver can reject wrapping discontinuities
+        return solveEquation(f, limits, knownScale, modN, { allRoots: wantAllRoots, intervalF, derivativeF, batchF, guess, stats, cancel });
+    }
+
+    // An identical problem solved before (see rootCacheKey). Profiling
+    // bypasses the cache so its counts show the work each solve does.
+    const cacheKey = _profile === null ? rootCacheKey(leftAST, rightAST, unknown, allVars, context, limits, modN, guess) : null;
+    const cached = cacheKey !== null ? rootCacheGet(cacheKey) : null;
+    if (cached !== null) {
+        if (cached.error !== null) {
+            return { solved: false, error: cached.error, variable: unknown };
+        }
+        if (allRoots) {
+            return { solved: true, variable: unknown, values: cachedRoots(cached, () => solveTarget(true)) };
+        }
+        if (cached.roots.length > 0) {
+            return { solved: true, variable: unknown, value: cached.roots[0] };
         }
     }
 
-    // Solve — pass modN so solver can reject wrapping discontinuities
     try {
-        const result = solveEquation(f, limits, knownScale, modN, { allRoots });
+        const result = solveTarget(allRoots);
         if (allRoots) {
+            let values = result;
+            if (cacheKey !== null) {
+                const entry = { roots: [], done: false, error: null };
+                rootCacheSet(cacheKey, entry);
+                values = cachedRoots(entry, () => result);
+            }
             return {
                 solved: true,
                 variable: unknown,
-                values: result // array in preference order
+                values // iterable in preference order
             };
         }
+        if (cacheKey !== null) rootCacheSet(cacheKey, { roots: [result], done: false, error: null });
         return {
             solved: true,
             variable: unknown,
             value: result
         };
     } catch (e) {
+        if (e instanceof SolveTimeoutError) throw e;
         // Solving failed (e.g., couldn't bracket root)
+        if (cacheKey !== null) rootCacheSet(cacheKey, { roots: [], done: true, error: e.message });
         return { solved: false, error: e.message, variable: unknown };
     }
 }
@@ -357,13 +615,314 @@ function resolveWithLimits(varName, decl, equations, declarations, context, reco
  * @param {Array} declarations - Variable declarations (for limits and user-provided tracking)
  * @param {Object} record - Record settings (places, degreesMode, etc.)
  * @param {Array} equations - Equations to solve (from findEquationsAndOutputs)
- * @returns {{ computedValues: Map, solved: number, errors: Array, solveFailures: Map, equationVarStatus: Map }}
+ * @param {SolveCancelToken} [cancelToken] - Deadline; defaults to the one
+ *     solveRecord was given. On expiry the search stops and the best partial
+ *     state is returned with timedOut set and a timeout error.
+ * @returns {{ computedValues: Map, solved: number, errors: Array, solveFailures: Map, equationVarStatus: Map, timedOut: boolean }}
  */
-// Trace buffer: null = disabled, [] = collecting lines for user-visible output.
-// Set by solveRecord(..., traceMode=true) for the outer solve only.
-let _traceBuffer = null;
-function _trace(msg) {
-    if (_traceBuffer !== null) _traceBuffer.push(msg);
+// Solve trace. Events are recorded as compact entries (event id, line,
+// name, value, plus an object reference for ASTs, alternatives and messages)
+// and only formatted into text on demand, so tracing is always on: outside
+// trace mode events go to a fixed-size ring (the most recent
+// TRACE_RING_SIZE survive, for dumping after an error); solveRecord(...,
+// traceMode=true) swaps in an unbounded ring for the outer solve, which
+// becomes the user-visible trace section. Referenced objects are never
+// mutated after the event (ASTs, equations, alternatives, fresh arrays), so
+// formatting later gives the text the event would have had at the time.
+// The always-on ring keeps no object references (they would pin ASTs,
+// equations and whole alternatives of past solves): only strings survive,
+// and events whose detail was an object format briefly (_traceBriefTable).
+// Detail that exists only for the trace (arrays of names, Brent's attempt
+// tuples, per-sub events) is built only when _traceDetailed().
+const TRACE_RING_SIZE = 4096;
+const _DROPPED_REF = {};
+
+class TraceRing {
+    /**
+     * @param {number} capacity - Entries kept; the oldest are overwritten
+     * @param {boolean} [bounded] - When false, grows instead of overwriting
+     * @param {boolean} [keepRefs] - When false, object refs aren't kept
+     */
+    constructor(capacity, bounded = true, keepRefs = true) {
+        this.bounded = bounded;
+        this.keepRefs = keepRefs;
+        this.ids = new Uint16Array(capacity);
+        this.lines = new Int32Array(capacity);
+        this.values = new Float64Array(capacity);
+        this.others = new Array(capacity); // values that aren't numbers
+        this.names = new Array(capacity);
+        this.refs = new Array(capacity);
+        this.start = 0;
+        this.length = 0;
+    }
+
+    push(id, line, name, value, ref) {
+        let cap = this.ids.length;
+        if (this.length === cap && !this.bounded) {
+            this._grow(cap * 2);
+            cap *= 2;
+        }
+        let i = this.start + this.length;
+        if (i >= cap) i -= cap;
+        this.ids[i] = id;
+        this.lines[i] = line;
+        if (typeof value === 'number') {
+            this.values[i] = value;
+            this.others[i] = undefined;
+        } else {
+            this.others[i] = this.keepRefs || value === null || typeof value !== 'object' ? value : '…';
+        }
+        this.names[i] = name;
+        this.refs[i] = this.keepRefs || ref === null || typeof ref !== 'object' ? ref : _DROPPED_REF;
+        if (this.length < cap) this.length++;
+        else if (++this.start === cap) this.start = 0;
+    }
+
+    _grow(capacity) {
+        const grow = (Type, old) => {
+            const a = Type === Array ? new Array(capacity) : new Type(capacity);
+            for (let k = 0; k < this.length; k++) a[k] = old[(this.start + k) % old.length];
+            return a;
+        };
+        this.ids = grow(Uint16Array, this.ids);
+        this.lines = grow(Int32Array, this.lines);
+        this.values = grow(Float64Array, this.values);
+        this.others = grow(Array, this.others);
+        this.names = grow(Array, this.names);
+        this.refs = grow(Array, this.refs);
+        this.start = 0;
+    }
+
+    clear() {
+        this.start = 0;
+        this.length = 0;
+        this.others.fill(undefined);
+        this.names.fill(undefined);
+        this.refs.fill(undefined);
+    }
+
+    /**
+     * Format the last `count` events (default all), oldest first, as trace lines
+     */
+    format(count = Infinity) {
+        const out = [];
+        const cap = this.ids.length;
+        const n = Math.min(count, this.length);
+        for (let k = this.length - n; k < this.length; k++) {
+            const i = (this.start + k) % cap;
+            const ref = this.refs[i];
+            const value = this.others[i] !== undefined ? this.others[i] : this.values[i];
+            const text = ref === _DROPPED_REF
+                ? _traceBriefFormats[this.ids[i]](this.lines[i], this.names[i], value)
+                : _traceFormats[this.ids[i]](this.lines[i], this.names[i], value, ref);
+            if (Array.isArray(text)) out.push(...text);
+            else out.push(text);
+        }
+        return out;
+    }
+}
+
+const _productionTrace = new TraceRing(TRACE_RING_SIZE, true, false);
+let _traceRing = _productionTrace;
+
+/**
+ * Record a trace event (see TraceEvent). `line` is a 0-based source line or a
+ * count/depth, `value` usually a number; `name` and `ref` are stored by reference.
+ */
+function _trace(id, line = -1, name = null, value = NaN, ref = null) {
+    _traceRing.push(id, line, name, value, ref);
+}
+
+/**
+ * True when the current ring keeps object refs (trace mode), i.e. when it's
+ * worth building trace-only detail; otherwise pass _DROPPED_REF instead
+ */
+function _traceDetailed() {
+    return _traceRing.keepRefs;
+}
+
+/**
+ * The most recent solve trace events outside trace mode, formatted as lines.
+ * Used to dump context when a solve throws.
+ */
+function recentSolveTrace(count = 50) {
+    return _productionTrace.format(count);
+}
+
+// Format the "[combo]" and " in L = R" annotations of a Brent's attempt:
+// the combo's non-self subs and the substituted equation Brent's was given.
+// Mirrors the applicableSubs construction in solveEquationInContext.
+function _comboTraceText(eq, comboSubs) {
+    if (!comboSubs || comboSubs.size === 0) return ['', ''];
+    const applicable = new Map();
+    const parts = [];
+    for (const [v, s] of comboSubs) {
+        if (s.sourceLine === eq.startLine) continue;
+        applicable.set(v, s.ast);
+        parts.push(`${v}@${s.sourceLine + 1}→${_astStr(s.ast)}`);
+    }
+    if (applicable.size === 0) return ['', ''];
+    const L = substituteInAST(eq.leftAST, applicable);
+    const R = substituteInAST(eq.rightAST, applicable);
+    return [` [${parts.join(', ')}]`, ` in ${_astStr(L)} = ${_astStr(R)}`];
+}
+
+// "from"/"with" lines under a branching attempt, showing the source line
+// and (for Kind 3) every sub in the combo except those from the equation's
+// own line, which would substitute a definition into itself. The old
+// `allVars` filter hid subs whose target variable wasn't in the equation's
+// literal vars — but chain substitution can pull such subs in transitively
+// (e.g. a → sqrt(z) then z → c2**3), so they are load-bearing and should be
+// visible in the trace.
+function _attemptTraceLines(alt) {
+    const lines = [];
+    if (alt.kind === 'directEval') {
+        lines.push(`      from (line ${alt.sub.sourceLine + 1}): ${alt.variable} = ${_astStr(alt.sub.ast)}`);
+        return lines;
+    }
+    if (alt.kind === 'newton') {
+        for (const eq of alt.eqs) lines.push(`      from (line ${eq.startLine + 1}): ${eq.text.trim()}`);
+        for (const [varName, value] of alt.values) {
+            if (varName !== alt.variable) lines.push(`      with ${varName} = ${value}`);
+        }
+        return lines;
+    }
+    lines.push(`      from (line ${alt.eq.startLine + 1}): ${alt.eq.text.trim()}`);
+    if (alt.combo && alt.combo.size > 0) {
+        for (const [varName, sub] of alt.combo) {
+            if (sub.sourceLine === alt.eq.startLine) continue;
+            lines.push(`      with (line ${sub.sourceLine + 1}): ${varName} → ${_astStr(sub.ast)}`);
+        }
+    }
+    return lines;
+}
+
+// Brent's attempt events: ref = [eq, comboSubs, detail], name = sweep kind
+const _brentsTrace = (detail) => (line, kind, value, [eq, combo, d]) => {
+    const [comboStr, subStr] = _comboTraceText(eq, combo);
+    return `    ${kind} line ${eq.startLine + 1}${comboStr}: ${detail(d)}${subStr}`;
+};
+
+// Event formatters: (line, name, value, ref) → line of text, or an array of lines
+const _traceFormatTable = {
+    SOLVE_BEGIN: (n, _, inputs) => `========== solveEquations (${n} equations, ${inputs} input expressions) ==========`,
+    PARTITIONED: (n) => `========== Partitioned into ${n} independent components ==========`,
+    FELL_BACK: () => `========== solveEquations fell back to candidate (no balanced branch) ==========`,
+    FAILED: () => `========== solveEquations FAILED (no complete solution) ==========`,
+    TIMED_OUT: (_, __, ___, message) => `========== ${message} ==========`,
+    PRE_BODY_HEADER: () => `--- Pre-recursion body definitions ---`,
+    PRE_BODY_VALUE: (_, name, value, ast) => `  ${name} = ${_astStr(ast)} = ${value}`,
+    PRE_BODY_ERROR: (_, name, __, message) => `  ${name}: eval error, deferred (${message})`,
+    PRE_BODY_DEFERRED: (_, name) => `  ${name}: deferred (has unknown deps)`,
+    INPUTS_HEADER: (n) => `  [1] Input expressions${n === 0 ? ' (none)' : ''}`,
+    INPUT_VALUE: (_, name, value, ast) => `    ${name} = ${_astStr(ast)} = ${value}`,
+    INPUT_DEFERRED: (_, name, __, message) => `    ${name}: deferred (${message})`,
+    INCOMPLETE: (_, leftText, value) => `    Incomplete: ${leftText} = ${value}`,
+    SUBS_HEADER: () => '  [2] Substitution map',
+    SUB: (line, name, _, ast) => `    line ${line + 1}: ${name} → ${_astStr(ast)}`,
+    NONE: () => '    (none)',
+    KNOWN_HEADER: () => '  [3] Evaluate fully-known substitutions',
+    KNOWN_VALUE: (_, name, value, ast) => `    ${name} = ${_astStr(ast)} = ${value}`,
+    KNOWN_OUTSIDE_LIMITS: (_, name) => `    ${name}: outside limits, skipped`,
+    KNOWN_AMBIGUOUS: (n, name) => `    ${name}: ambiguous (${n} alternates) — deferred to branching`,
+    KNOWN_DEFERRED: (_, name) => `    ${name}: deferred`,
+    KNOWN_DEFERRED_SUB: (line, _, __, unknowns) => `      line ${line + 1}: unknowns ${unknowns.join(', ')}`,
+    SWEEP_SUBS: (_, __, ___, names) => `  [4] Sweep subs: ${names.join(', ') || '(none)'}`,
+    BRENTS_ERROR: _brentsTrace(message => message),
+    BRENTS_LIMITS_DEFERRED: _brentsTrace(() => 'limits deferred'),
+    BRENTS_TOO_MANY: _brentsTrace(unknowns => `too many unknowns (${unknowns.join(', ')})`),
+    BRENTS_FAILED: _brentsTrace(r => `${r.error} for '${r.variable}'`),
+    ADVANCE: (depth) => `--- Advance (depth ${depth}) ---`,
+    BALANCED: (depth) => `  ✓ balanced (depth ${depth})`,
+    BRANCHING: (depth) => `  [5] Branching (depth ${depth})`,
+    TRY: (_, __, ___, alt) => [`    Try ${alt.kind}: ${alt.variable} = ${alt.value} (${alt.sourceLabel})`, ..._attemptTraceLines(alt)],
+    REJECTED_LIMIT: (_, __, ___, alt) => `    Rejected: ${alt.variable} = ${alt.value} (limit check)`,
+    REJECTED_DOWNSTREAM: (_, __, ___, alt) => `    Rejected: ${alt.variable} = ${alt.value} (downstream failed)`,
+    NO_ALTERNATIVES: () => `    (no alternatives available)`,
+    PLAN_STEP: (n, _, __, step) => `    Plan step ${n}: ${step.kind} ${step.variable}`,
+    CANDIDATE_REJECTED: (depth, _, __, alt) => `  · candidate (depth ${depth}): rejected by limit check: ${alt.variable} = ${alt.value}`,
+    CANDIDATE_STUCK: (depth) => `  · candidate (depth ${depth}): no balanced branch found`,
+    DISCOVERY_HEADER: () => '--- Variable discovery ---',
+    DISCOVERY_KNOWN_HEADER: () => '  known:',
+    DISCOVERY_KNOWN: (_, name, value) => `    ${name} = ${value}`,
+    DISCOVERY_UNKNOWN: (_, __, ___, names) => `  unknown: ${names.join(', ')}`,
+    EQUATIONS_HEADER: (n) => `--- Equations (${n}) ---`,
+    EQUATION: (line, _, __, eq) => `  line ${line + 1}${eq.modN ? ' [°=]' : ''}: ${eq.text.substring(0, 80)}`
+};
+// Formats for events whose object ref the production ring dropped:
+// (line, name, value) → text, with … where the detail was
+const _brentsBrief = (line, kind) => `    ${kind} line ${line + 1}: …`;
+const _traceBriefTable = {
+    PRE_BODY_VALUE: (_, name, value) => `  ${name} = … = ${value}`,
+    INPUT_VALUE: (_, name, value) => `    ${name} = … = ${value}`,
+    KNOWN_VALUE: (_, name, value) => `    ${name} = … = ${value}`,
+    SWEEP_SUBS: () => '  [4] Sweep subs: …',
+    BRENTS_ERROR: _brentsBrief,
+    BRENTS_LIMITS_DEFERRED: _brentsBrief,
+    BRENTS_TOO_MANY: _brentsBrief,
+    BRENTS_FAILED: _brentsBrief,
+    TRY: (_, name, value) => `    Try: ${name} = ${value}`,
+    REJECTED_LIMIT: (_, name, value) => `    Rejected: ${name} = ${value} (limit check)`,
+    REJECTED_DOWNSTREAM: (_, name, value) => `    Rejected: ${name} = ${value} (downstream failed)`,
+    PLAN_STEP: (n) => `    Plan step ${n}: …`,
+    CANDIDATE_REJECTED: (depth, name, value) => `  · candidate (depth ${depth}): rejected by limit check: ${name} = ${value}`,
+    DISCOVERY_UNKNOWN: () => '  unknown: …',
+    EQUATION: (line) => `  line ${line + 1}: …`
+};
+const TraceEvent = {};
+const _traceFormats = [];
+const _traceBriefFormats = [];
+for (const [name, format] of Object.entries(_traceFormatTable)) {
+    TraceEvent[name] = _traceFormats.length;
+    _traceFormats.push(format);
+    _traceBriefFormats.push(_traceBriefTable[name] || (() => `    ${name} …`));
+}
+
+// Deadline / cancellation token of the current solveRecord (null = none).
+// solveEquations and solveEquationsByComponent default to it, so nested
+// solves (OUTPUT-with-limits re-solves, table cells) share the budget.
+let _cancelToken = null;
+
+// Table row loops: true (after recording why) once the solve's deadline has
+// passed, so the table keeps the rows computed so far
+function _tableDeadlinePassed(errors, tableDef, done, unit) {
+    if (_cancelToken === null || !_cancelToken.expired) return false;
+    const reason = _cancelToken.cancelled ? 'solve cancelled' : `solve timed out after ${_cancelToken.timeoutMs} ms`;
+    errors.push(`Line ${tableDef.startLine}: Table stopped after ${done} ${unit}: ${reason}`);
+    return true;
+}
+
+// Solve profile: null = disabled, else work counters keyed by
+// "line:unknown" (see _profileEntry). Set by solveRecord(..., profileMode=true).
+// Unlike the trace it stays on during tables and OUTPUT-with-limits re-solves,
+// since those are where slow records usually spend their time. Every counting
+// site is a null check, so leaving it on costs little.
+let _profile = null;
+function _newProfile() {
+    return { entries: new Map(), attempts: new Map(), substitutionBuilds: 0, maxSubstitutions: 0, branchesTried: 0, branchesRestored: 0 };
+}
+// One solveEquationInContext call on an equation, whatever its outcome
+// (too many unknowns, deferred, solved); ms excludes roots refined lazily.
+function _profileAttempt(line, t0) {
+    let a = _profile.attempts.get(line);
+    if (!a) _profile.attempts.set(line, a = { attempts: 0, ms: 0 });
+    a.attempts++;
+    a.ms += performance.now() - t0;
+}
+function _profileEntry(line, variable) {
+    const key = `${line}:${variable}`;
+    let e = _profile.entries.get(key);
+    if (!e) {
+        e = { line, variable, solves: 0, evals: 0, brentIterations: 0, newtonSteps: 0, expansions: 0,
+              branchesTried: 0, branchesRestored: 0, substitutions: 0 };
+        _profile.entries.set(key, e);
+    }
+    return e;
+}
+function _profileBranch(alt, field) {
+    _profile[field]++;
+    const line = alt.kind === 'directEval' ? alt.sourceLine : (alt.eq ? alt.eq.startLine : null);
+    if (line !== null && line !== undefined) _profileEntry(line, alt.variable)[field]++;
 }
 
 // Simple AST to string for debug logging
@@ -527,24 +1086,101 @@ function* cartesianOver(chosenKeys, defSubs) {
 /**
  * Dedupe mod-equivalent roots for °= equations. Two roots that differ by
  * a multiple of modN collapse to one, keeping the smallest positive rep.
+ * Generator, so a lazily-refined root sequence stays lazy.
  */
-function dedupeModEquivalent(values, modN) {
-    const seen = new Map(); // canonical rep → value
-    const out = [];
+function* dedupeModEquivalent(values, modN) {
+    const seen = new Set(); // canonical reps already yielded
     for (const v of values) {
         let canon = ((v % modN) + modN) % modN;
         if (canon > modN / 2) canon -= modN; // fold to (-modN/2, modN/2]
         const key = Math.round(canon * 1e9) / 1e9; // bucket nearby values
         if (!seen.has(key)) {
-            seen.set(key, v);
-            out.push(v);
+            seen.add(key);
+            yield v;
+        }
+    }
+}
+
+/**
+ * Solve plans for repeated solves of one record with different inputs
+ * (parameter sweeps). When a solve balances, solveEquations records the
+ * branching decisions on the winning branch — which variable came from
+ * which equation (and substitution combo), direct-eval substitution, or
+ * Newton block — under a key for the problem's structure: its equations,
+ * body definitions, the set of variables still unknown, and angle mode.
+ * The next solve with that structure tries each recorded decision first at
+ * its depth and falls back to the full search from the first one that
+ * doesn't lead to a balanced state; the plan it ends up with replaces the
+ * old one. Values are never replayed, only choices, so every root is
+ * re-solved for the new inputs.
+ *
+ * Opt-in: used only when context.solvePlans holds a SolvePlans, shared by
+ * the sweep's solves. With several solutions, replay keeps following the
+ * branch the previous solve took, where a fresh search might pick another.
+ */
+class SolvePlans {
+    constructor(limit = 1000) {
+        this.limit = limit;
+        this.plans = new Map(); // structure key → [step]
+        this.replayed = 0;      // solves that balanced along their plan
+        this.fellBack = 0;      // solves whose plan didn't lead to balance
+        this.recorded = 0;      // solves with no plan yet
+    }
+
+    get(key) {
+        const plan = this.plans.get(key);
+        if (plan === undefined) return null;
+        this.plans.delete(key); // refresh recency
+        this.plans.set(key, plan);
+        return plan;
+    }
+
+    set(key, plan) {
+        this.plans.delete(key);
+        if (this.plans.size >= this.limit) this.plans.delete(this.plans.keys().next().value);
+        this.plans.set(key, plan);
+    }
+}
+
+function solvePlanKey(equations, bodyDefinitions, requiredVars, record) {
+    return [
+        equations.map(eq => `${eq.startLine}${eq.modN ? '°' : ''}:${eq.text}`).join('\n'),
+        bodyDefinitions.map(def => `${def.name}:${def.exprText}`).join('\n'),
+        [...requiredVars].sort().join(','),
+        record.degreesMode ? 'deg' : 'rad'
+    ].join('\n|\n');
+}
+
+// Identity of a branching decision, without its value
+function planStepKey(alt) {
+    switch (alt.kind) {
+        case 'directEval':
+            return `directEval|${alt.variable}|${alt.sourceLine}`;
+        case 'newton':
+            return `newton|${alt.eqs.map(eq => eq.startLine).join(',')}`;
+        default: {
+            const combo = alt.combo ? [...alt.combo].map(([v, sub]) => `${v}@${sub.sourceLine}`).sort().join(',') : '';
+            return `${alt.kind}|${alt.variable}|${alt.eq.startLine}|${combo}`;
         }
     }
-    return out;
 }
 
-function solveEquations(context, declarations, record = {}, equations, bodyDefinitions = [], skipLimitValidation = false) {
-    _trace(`========== solveEquations (${equations.length} equations, ${bodyDefinitions.length} input expressions) ==========`);
+function planStep(alt) {
+    const step = { key: planStepKey(alt), kind: alt.kind, variable: alt.variable };
+    if (alt.kind === 'directEval') {
+        step.line = alt.sourceLine;
+    } else if (alt.kind === 'newton') {
+        step.lines = alt.eqs.map(eq => eq.startLine);
+        step.names = [...alt.values.keys()];
+    } else {
+        step.line = alt.eq.startLine;
+        step.combo = alt.combo ? [...alt.combo].map(([v, sub]) => [v, sub.sourceLine]) : [];
+    }
+    return step;
+}
+
+function solveEquations(context, declarations, record = {}, equations, bodyDefinitions = [], skipLimitValidation = false, cancelToken = _cancelToken) {
+    _trace(TraceEvent.SOLVE_BEGIN, equations.length, null, bodyDefinitions.length);
     const places = record.places != null ? record.places : 4;
     const errors = [];
     // Report any equation parse errors from preParseEquations
@@ -584,21 +1220,30 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
         }
     }
 
+    // Opt-in solve plan (see SolvePlans): the decisions that balanced the
+    // last solve with this structure, tried first; path is the current branch
+    const plans = context.solvePlans instanceof SolvePlans ? context.solvePlans : null;
+    const planKey = plans ? solvePlanKey(equations, bodyDefinitions, requiredVars, record) : null;
+    const plan = plans ? plans.get(planKey) : null;
+    const path = [];
+
     const maxIterations = 50;
     const erroredEquations = new Set();
     const unsolvedEquations = new Map(); // line → [unknown names]
 
-    // Split body definitions into two phases:
+    // Split body definitions into two phases, visiting them in dependency
+    // order (orderBodyDefinitions) so a chain of definitions fires in one go:
     //   Pre-recursion: defs whose RHS references only already-known vars.
     //     Evaluates ONCE per solve — covers `r: rand()`, `t: Now()`, and
     //     `r: rate/100/12` when rate is a user input. No re-evaluation on backtrack.
     //   In-recursion (pendingBodyDefs): defs that depend on unknowns. These retry
-    //     in pass [1] of the deterministic advance loop as their deps get solved.
+    //     in pass [1] of the deterministic advance loop as their deps get solved,
+    //     in the same order, so one pass fires every def a new value unblocks.
     //     Snapshot/restore handles them naturally via context.variables.
     const pendingBodyDefs = [];
     if (bodyDefinitions.length > 0) {
-        _trace(`--- Pre-recursion body definitions ---`);
-        for (const def of bodyDefinitions) {
+        _trace(TraceEvent.PRE_BODY_HEADER);
+        for (const def of orderBodyDefinitions(bodyDefinitions, context).ordered) {
             if (!def.ast || context.hasVariable(def.name)) continue;
             if (isFullyKnownAST(def.ast, context)) {
                 try {
@@ -607,15 +1252,15 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
                     context.firedBodyDefs.add(def.name);
                     // Body defs don't count toward "Solved N" — they're declaration
                     // evaluations, not equation solves (matches old iterative solver).
-                    _trace(`  ${def.name} = ${_astStr(def.ast)} = ${value}`);
+                    _trace(TraceEvent.PRE_BODY_VALUE, -1, def.name, value, def.ast);
                 } catch (e) {
                     // No unknowns but still errors — push to errors at terminal pass.
                     pendingBodyDefs.push(def);
-                    _trace(`  ${def.name}: eval error, deferred (${e.message})`);
+                    _trace(TraceEvent.PRE_BODY_ERROR, -1, def.name, NaN, e.message);
                 }
             } else {
                 pendingBodyDefs.push(def);
-                _trace(`  ${def.name}: deferred (has unknown deps)`);
+                _trace(TraceEvent.PRE_BODY_DEFERRED, -1, def.name);
             }
         }
     }
@@ -674,7 +1319,7 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
             // while any dep is unbound, naturally deferring until ready. The
             // firedBodyDefs gate fires each def exactly once (so `s: s+1` lifts
             // a solver-set s=5 to s=6 without looping).
-            _trace(`  [1] Input expressions${pendingBodyDefs.length === 0 ? ' (none)' : ''}`);
+            _trace(TraceEvent.INPUTS_HEADER, pendingBodyDefs.length);
             for (const { name, ast } of pendingBodyDefs) {
                 if (!ast || context.firedBodyDefs.has(name)) continue;
                 try {
@@ -682,9 +1327,9 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
                     context.setVariable(name, value);
                     context.firedBodyDefs.add(name);
                     progressed = true;
-                    _trace(`    ${name} = ${_astStr(ast)} = ${value}`);
+                    _trace(TraceEvent.INPUT_VALUE, -1, name, value, ast);
                 } catch (e) {
-                    _trace(`    ${name}: deferred (${e.message})`);
+                    _trace(TraceEvent.INPUT_DEFERRED, -1, name, NaN, e.message);
                 }
             }
 
@@ -700,22 +1345,38 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
                         computedValues.set(key, value);
                         solved++;
                         progressed = true;
-                        _trace(`    Incomplete: ${eq.leftText} = ${value}`);
+                        _trace(TraceEvent.INCOMPLETE, eq.startLine, eq.leftText, value);
                     }
                 } catch (e) { /* unknown variables — skip */ }
             }
 
             // [2] Build substitution map
             substitutions = buildSubstitutionMap(equations, context);
-            _trace('  [2] Substitution map');
-            if (substitutions.size > 0) {
+            if (_profile !== null) {
+                _profile.substitutionBuilds++;
+                _profile.maxSubstitutions = Math.max(_profile.maxSubstitutions, substitutions.size);
+                const counts = new Map();
+                for (const [k, subs] of substitutions) {
+                    for (const sub of subs) {
+                        const key = `${sub.sourceLine}:${k}`;
+                        counts.set(key, (counts.get(key) || 0) + 1);
+                    }
+                }
+                for (const [key, n] of counts) {
+                    const sep = key.indexOf(':');
+                    const e = _profileEntry(Number(key.slice(0, sep)), key.slice(sep + 1));
+                    e.substitutions = Math.max(e.substitutions, n);
+                }
+            }
+            _trace(TraceEvent.SUBS_HEADER);
+            if (substitutions.size === 0) {
+                _trace(TraceEvent.NONE);
+            } else if (_traceDetailed()) {
                 for (const [k, subs] of substitutions) {
                     for (const s of subs) {
-                        _trace(`    line ${s.sourceLine + 1}: ${k} → ${_astStr(s.ast)}`);
+                        _trace(TraceEvent.SUB, s.sourceLine, k, NaN, s.ast);
                     }
                 }
-            } else {
-                _trace('    (none)');
             }
 
             // [3] Evaluate fully-known substitutions.
@@ -735,7 +1396,7 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
             //   2+ non-NaN         → ambiguous, defer to Kind 1 branching
             //   0 non-NaN + 1 NaN  → NaN fallback, resolve (single option)
             //   0 non-NaN + 2+ NaN → deferred (multiple NaN subs — no obvious pick)
-            _trace('  [3] Evaluate fully-known substitutions');
+            _trace(TraceEvent.KNOWN_HEADER);
             for (const [varName, subs] of substitutions) {
                 if (context.hasVariable(varName)) continue;
                 const candidates = [];
@@ -745,7 +1406,7 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
                     const subUnknowns = [...findVariablesInAST(sub.ast)]
                         .filter(v => !context.hasVariable(v));
                     if (subUnknowns.length > 0) {
-                        unknownSubs.push({ sub, unknowns: subUnknowns });
+                        if (_traceDetailed()) unknownSubs.push({ sub, unknowns: subUnknowns });
                         continue;
                     }
                     try {
@@ -755,7 +1416,7 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
                         else candidates.push({ sub, value: v });
                     } catch (e) {
                         // EvalError = "this sub doesn't apply" (skip silently).
-                        // Anything else (e.g. RangeError stack overflow from a
+                        // Anything else (e.g. CallDepthError from a runaway
                         // recursive user function) is a real failure — surface it.
                         if (!(e instanceof EvalError)) {
                             errors.push(`Line ${sub.sourceLine + 1}: ${e.message}`);
@@ -773,9 +1434,9 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
                     try {
                         if (applyDirectValue(varName, value, sub.sourceLine)) {
                             progressed = true;
-                            _trace(`    ${varName} = ${_astStr(sub.ast)} = ${value}`);
+                            _trace(TraceEvent.KNOWN_VALUE, sub.sourceLine, varName, value, sub.ast);
                         } else {
-                            _trace(`    ${varName}: outside limits, skipped`);
+                            _trace(TraceEvent.KNOWN_OUTSIDE_LIMITS, sub.sourceLine, varName);
                         }
                     } catch (e) {
                         if (!(e instanceof EvalError)) {
@@ -784,11 +1445,11 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
                     }
                 } else if (candidates.length >= 2) {
                     // Ambiguous — leave for Kind 1 branching.
-                    _trace(`    ${varName}: ambiguous (${candidates.length} alternates) — deferred to branching`);
-                } else if (_traceBuffer !== null) {
-                    _trace(`    ${varName}: deferred`);
+                    _trace(TraceEvent.KNOWN_AMBIGUOUS, candidates.length, varName);
+                } else {
+                    _trace(TraceEvent.KNOWN_DEFERRED, -1, varName);
                     for (const { sub, unknowns } of unknownSubs) {
-                        _trace(`      line ${sub.sourceLine + 1}: unknowns ${unknowns.join(', ')}`);
+                        _trace(TraceEvent.KNOWN_DEFERRED_SUB, sub.sourceLine, varName, NaN, unknowns);
                     }
                 }
             }
@@ -807,7 +1468,8 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
                     definitionSubs.set(varName, subs);
                 }
             }
-            _trace(`  [4] Sweep subs: ${[...definitionSubs.keys()].join(', ') || '(none)'}`);
+            _trace(TraceEvent.SWEEP_SUBS, -1, null, NaN,
+                _traceDetailed() ? [...definitionSubs.keys()] : _DROPPED_REF);
         }
         return { substitutions, definitionSubs };
     }
@@ -836,48 +1498,33 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
     // bookkeeping that Kind 2 and Kind 3 would otherwise duplicate.
     function* rootsFromBrents(eq, comboSubs, kind) {
         const modValue = eq.modN ? (record.degreesMode ? 360 : 2 * Math.PI) : null;
-        // Build trace annotations: the combo's non-self subs (showing what was
-        // applied) and the substituted equation form (showing the result Brent's
-        // was given). Skip when tracing is off or combo is empty/all-self.
-        // Mirrors the applicableSubs construction in solveEquationInContext.
-        let comboStr = '', subStr = '';
-        if (_traceBuffer !== null && comboSubs && comboSubs.size > 0) {
-            const applicable = new Map();
-            const parts = [];
-            for (const [v, s] of comboSubs) {
-                if (s.sourceLine === eq.startLine) continue;
-                applicable.set(v, s.ast);
-                parts.push(`${v}@${s.sourceLine + 1}→${_astStr(s.ast)}`);
-            }
-            if (applicable.size > 0) {
-                comboStr = ` [${parts.join(', ')}]`;
-                const L = substituteInAST(eq.leftAST, applicable);
-                const R = substituteInAST(eq.rightAST, applicable);
-                subStr = ` in ${_astStr(L)} = ${_astStr(R)}`;
-            }
-        }
+        if (cancelToken) cancelToken.check();
         let r;
+        const t0 = _profile !== null ? performance.now() : 0;
         try {
             r = solveEquationInContext(eq.startLine, context, variables,
-                comboSubs, modValue, eq.leftAST, eq.rightAST, { allRoots: true });
+                comboSubs, modValue, eq.leftAST, eq.rightAST, { allRoots: true, cancel: cancelToken });
         } catch (e) {
-            _trace(`    ${kind} line ${eq.startLine + 1}${comboStr}: ${e.message}${subStr}`);
+            if (e instanceof SolveTimeoutError) throw e;
+            _trace(TraceEvent.BRENTS_ERROR, eq.startLine, kind, NaN, _traceDetailed() ? [eq, comboSubs, e.message] : _DROPPED_REF);
             errors.push(`Line ${eq.startLine + 1}: ${e.message}`);
             erroredEquations.add(eq.startLine);
+            if (_profile !== null) _profileAttempt(eq.startLine, t0);
             return;
         }
+        if (_profile !== null) _profileAttempt(eq.startLine, t0);
         if (r.limitsDeferred) {
-            _trace(`    ${kind} line ${eq.startLine + 1}${comboStr}: limits deferred${subStr}`);
+            _trace(TraceEvent.BRENTS_LIMITS_DEFERRED, eq.startLine, kind, NaN, _traceDetailed() ? [eq, comboSubs, null] : _DROPPED_REF);
             return;
         }
         if (r.tooManyUnknowns) {
-            _trace(`    ${kind} line ${eq.startLine + 1}${comboStr}: too many unknowns (${r.tooManyUnknowns.join(', ')})${subStr}`);
+            _trace(TraceEvent.BRENTS_TOO_MANY, eq.startLine, kind, NaN, _traceDetailed() ? [eq, comboSubs, r.tooManyUnknowns] : _DROPPED_REF);
             unsolvedEquations.set(eq.startLine, r.tooManyUnknowns);
             return;
         }
         if (!r.solved) {
             if (r.error && r.variable) {
-                _trace(`    ${kind} line ${eq.startLine + 1}${comboStr}: ${r.error} for '${r.variable}'${subStr}`);
+                _trace(TraceEvent.BRENTS_FAILED, eq.startLine, kind, NaN, _traceDetailed() ? [eq, comboSubs, r] : _DROPPED_REF);
                 solveFailures.set(r.variable, { error: r.error, line: eq.startLine });
             }
             return;
@@ -902,6 +1549,7 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
     //           Cheapest; catches Test 7's NaN recovery.
     //   Kind 2: sweep-0 natural 1-unknown equations (all roots via allRoots).
     //   Kind 3: sweep-1 with cartesian combos of sub alternates (all roots).
+    //   (Kind 4, simultaneous Newton, is added by branchAlternatives.)
     function* enumerateAlternatives(substitutions, definitionSubs) {
         // --- Kind 1: direct-eval alternates ---
         // Matches [3]'s candidate rule: non-NaN (finite or ±Infinity) counts.
@@ -991,12 +1639,247 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
         }
     }
 
+    // Kind 4: simultaneous Newton, tried only when Kinds 1-3 have nothing —
+    // the remaining equations are coupled so that no single-unknown solve
+    // (even after substitution) reduces them, e.g. `x*exp(x) + y**3 = 5`
+    // with `x**3 - exp(y)*y = 1`.
+    //
+    // With a solve plan whose steps the current branch has followed so far,
+    // the plan's next decision goes first (and isn't repeated after).
+    function* branchAlternatives(substitutions, definitionSubs) {
+        let any = false;
+        let plannedKey = null;
+        if (plan && path.length < plan.length && path.every((alt, i) => planStepKey(alt) === plan[i].key)) {
+            const step = plan[path.length];
+            plannedKey = step.key;
+            _trace(TraceEvent.PLAN_STEP, path.length + 1, null, NaN, step);
+            for (const alt of plannedAlternatives(step, substitutions, definitionSubs)) {
+                any = true;
+                yield alt;
+            }
+        }
+        for (const alt of enumerateAlternatives(substitutions, definitionSubs)) {
+            if (plannedKey !== null && planStepKey(alt) === plannedKey) continue;
+            any = true;
+            yield alt;
+        }
+        if (!any) yield* simultaneousAlternatives();
+    }
+
+    // The candidates of one recorded decision, rebuilt for the current
+    // state; nothing when it no longer applies
+    function* plannedAlternatives(step, substitutions, definitionSubs) {
+        const byLine = (line) => equations.find(eq => eq.startLine === line && eq.leftAST && eq.rightAST
+            && !erroredEquations.has(eq.startLine));
+        if (step.kind === 'newton') {
+            const eqs = step.lines.map(byLine);
+            if (eqs.includes(undefined) || step.names.some(v => context.hasVariable(v))) return;
+            yield* newtonRoots(eqs, step.names);
+            return;
+        }
+        if (context.hasVariable(step.variable)) return;
+        if (step.kind === 'directEval') {
+            const sub = (substitutions.get(step.variable) || []).find(s => s.sourceLine === step.line);
+            if (!sub || [...findVariablesInAST(sub.ast)].some(v => !context.hasVariable(v))) return;
+            try {
+                const value = evaluate(sub.ast, context);
+                if (Number.isNaN(value)) return;
+                yield {
+                    kind: 'directEval',
+                    variable: step.variable,
+                    value,
+                    sub,
+                    sourceLine: sub.sourceLine,
+                    sourceLabel: `from line ${sub.sourceLine + 1}, direct eval`,
+                };
+            } catch (e) { /* doesn't apply to these inputs */ }
+            return;
+        }
+        const eq = byLine(step.line);
+        if (!eq) return;
+        const comboSubs = new Map();
+        for (const [varName, line] of step.combo) {
+            const sub = (definitionSubs.get(varName) || []).find(s => s.sourceLine === line);
+            if (!sub) return;
+            comboSubs.set(varName, sub);
+        }
+        yield* rootsFromBrents(eq, comboSubs, step.kind);
+    }
+
+    // Group the equations still holding unknowns into blocks connected by
+    // shared unknowns, and yield the Newton solutions of each block with at
+    // least as many equations as unknowns (≥2 unknowns; one is Brent's job).
+    // Blocks holding a pending body definition's variable are left to phase
+    // [1], which would override whatever Newton set.
+    function* simultaneousAlternatives() {
+        const pendingNames = new Set(pendingBodyDefs.map(def => def.name));
+        const blockOf = new Map(); // unknown → block
+        const blocks = [];
+        for (const eq of equations) {
+            if (!eq.leftAST || !eq.rightAST || erroredEquations.has(eq.startLine)) continue;
+            const unknowns = [...eq.allVars].filter(v => !context.hasVariable(v));
+            if (unknowns.length === 0) continue;
+            // Merge every block this equation touches into the first one
+            let block = null;
+            for (const v of unknowns) {
+                const other = blockOf.get(v);
+                if (!other || other === block) continue;
+                if (!block) {
+                    block = other;
+                    continue;
+                }
+                block.eqs.push(...other.eqs);
+                for (const u of other.unknowns) {
+                    block.unknowns.add(u);
+                    blockOf.set(u, block);
+                }
+                blocks.splice(blocks.indexOf(other), 1);
+            }
+            if (!block) blocks.push(block = { eqs: [], unknowns: new Set() });
+            block.eqs.push(eq);
+            for (const v of unknowns) {
+                block.unknowns.add(v);
+                blockOf.set(v, block);
+            }
+        }
+        for (const block of blocks) {
+            const names = [...block.unknowns];
+            if (names.length < 2 || block.eqs.length < names.length) continue;
+            if (names.some(v => pendingNames.has(v))) continue;
+            block.eqs.sort((a, b) => a.startLine - b.startLine);
+            yield* newtonRoots(block.eqs, names);
+        }
+    }
+
+    // Run damped Newton on one block from a few starting points and yield
+    // each distinct solution that balances every equation of the block.
+    // Starts from the pre-solve values (else the middle of the limits, else
+    // 1), then from that point skewed slightly per unknown (so a symmetric
+    // system doesn't start on its singular diagonal), negated, and scaled by
+    // 10 and 1/10.
+    function* newtonRoots(blockEqs, names) {
+        const modValue = record.degreesMode ? 360 : 2 * Math.PI;
+        const n = names.length, m = blockEqs.length;
+        const stats = _profile !== null ? _profileEntry(blockEqs[0].startLine, names[0]) : null;
+        if (stats) stats.solves++;
+
+        const lower = new Float64Array(n).fill(-Infinity);
+        const upper = new Float64Array(n).fill(Infinity);
+        const x0 = new Float64Array(n);
+        names.forEach((v, j) => {
+            const varInfo = variables.get(v);
+            let mid = null;
+            if (varInfo && varInfo.declaration && varInfo.declaration.limits) {
+                try {
+                    const { low, high } = evalLimitRange(varInfo.declaration.limits, context);
+                    lower[j] = low;
+                    upper[j] = high;
+                    mid = (low + high) / 2;
+                } catch (e) { /* unbounded until the limits evaluate */ }
+            }
+            const previous = context.preSolveValues ? context.preSolveValues.get(v) : undefined;
+            x0[j] = typeof previous === 'number' && isFinite(previous) ? previous
+                : mid !== null && isFinite(mid) ? mid : 1;
+        });
+
+        const wrap = (eq, diff) => eq.modN ? diff - modValue * Math.round(diff / modValue) : diff;
+        const F = (x) => {
+            if (stats) stats.evals++;
+            const ctx = context.clone();
+            names.forEach((v, j) => ctx.setVariable(v, x[j]));
+            return Float64Array.from(blockEqs, eq => {
+                try {
+                    return wrap(eq, evaluate(eq.leftAST, ctx) - evaluate(eq.rightAST, ctx));
+                } catch (e) {
+                    return NaN;
+                }
+            });
+        };
+
+        // Jacobian by forward-mode AD, one column per unknown over just the
+        // equations that use it (the rest of the column is zero); by forward
+        // differences when some equation has no derivative form
+        const dual = blockEqs.every(eq => canEvaluateDual(eq.leftAST, context) && canEvaluateDual(eq.rightAST, context));
+        const FJ = (x) => {
+            const f = F(x);
+            const jac = blockEqs.map(() => new Float64Array(n));
+            for (let j = 0; j < n; j++) {
+                if (dual) {
+                    if (stats) stats.evals++;
+                    const bindings = new Map(names.map((v, k) => [v, [x[k], k === j ? 1 : 0]]));
+                    blockEqs.forEach((eq, i) => {
+                        if (!eq.allVars.has(names[j])) return;
+                        try {
+                            const [, leftDer] = evaluateDual(eq.leftAST, context, bindings);
+                            const [, rightDer] = evaluateDual(eq.rightAST, context, bindings);
+                            jac[i][j] = leftDer - rightDer;
+                        } catch (e) {
+                            jac[i][j] = NaN;
+                        }
+                    });
+                } else {
+                    const h = Math.sqrt(Number.EPSILON) * Math.max(Math.abs(x[j]), 1);
+                    const xh = Float64Array.from(x);
+                    xh[j] += h;
+                    const fh = F(xh);
+                    for (let i = 0; i < m; i++) jac[i][j] = (fh[i] - f[i]) / h;
+                }
+            }
+            return { f, jac };
+        };
+
+        const balances = (x) => {
+            const ctx = context.clone();
+            names.forEach((v, j) => ctx.setVariable(v, x[j]));
+            return blockEqs.every(eq => {
+                try {
+                    const leftVal = evaluate(eq.leftAST, ctx);
+                    const rightVal = evaluate(eq.rightAST, ctx);
+                    return (eq.modN
+                        ? modCheckBalance(leftVal, rightVal, modValue, places)
+                        : checkBalance(leftVal, rightVal, places)).balanced;
+                } catch (e) {
+                    return false;
+                }
+            });
+        };
+
+        const found = [];
+        const starts = [x0, ...[1, -1, 10, 0.1].map(scale => x0.map((v, j) => v * scale * (1 + j / 16)))];
+        for (const start of starts) {
+            const x = newtonSystem(F, FJ, start,
+                { lower, upper, stats, cancel: cancelToken });
+            if (!x || !balances(x)) continue;
+            const same = (y) => y.every((v, j) => Math.abs(v - x[j]) <= 1e-9 * Math.max(1, Math.abs(x[j])));
+            if (found.some(same)) continue;
+            found.push(x);
+            const lines = blockEqs.map(eq => eq.startLine + 1);
+            yield {
+                kind: 'newton',
+                variable: names[0],
+                value: x[0],
+                values: new Map(names.map((v, j) => [v, x[j]])),
+                eq: blockEqs[0],
+                eqs: blockEqs,
+                sourceLabel: `from lines ${lines.join(', ')}, simultaneous Newton`,
+            };
+        }
+    }
+
     // Apply a branching decision: set the variable and, for sweep-1 combos,
     // lock in the chosen sub alternates so the next recursion level doesn't
     // have to re-discover the combo's forced values. Returns true if the
     // primary variable was successfully bound; false if applyDirectValue
     // rejected it (e.g. limit check failure).
     function applyDecision(alt) {
+        // Newton's solution binds every unknown of its block, or none
+        if (alt.kind === 'newton') {
+            let i = 0;
+            for (const [varName, value] of alt.values) {
+                if (!applyDirectValue(varName, value, alt.eqs[Math.min(i++, alt.eqs.length - 1)].startLine)) return false;
+            }
+            return true;
+        }
         const sourceLine = alt.kind === 'directEval'
             ? alt.sourceLine
             : (alt.eq ? alt.eq.startLine : null);
@@ -1019,28 +1902,6 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
         return true;
     }
 
-    function buildAttemptTraceLines(alt) {
-        const lines = [];
-        if (alt.kind === 'directEval') {
-            lines.push(`      from (line ${alt.sub.sourceLine + 1}): ${alt.variable} = ${_astStr(alt.sub.ast)}`);
-            return lines;
-        }
-        lines.push(`      from (line ${alt.eq.startLine + 1}): ${alt.eq.text.trim()}`);
-        // Show every sub in the combo (except those from the equation's own
-        // line, which would substitute a definition into itself). The old
-        // `allVars` filter hid subs whose target variable wasn't in the
-        // equation's literal vars — but chain substitution can pull such
-        // subs in transitively (e.g. a → sqrt(z) then z → c2**3), so they
-        // are load-bearing and should be visible in the trace.
-        if (alt.combo && alt.combo.size > 0) {
-            for (const [varName, sub] of alt.combo) {
-                if (sub.sourceLine === alt.eq.startLine) continue;
-                lines.push(`      with (line ${sub.sourceLine + 1}): ${varName} → ${_astStr(sub.ast)}`);
-            }
-        }
-        return lines;
-    }
-
     // bestCandidate is a snapshot of a "final but imperfect" state — used to
     // surface partial answers to the user when no branch reaches a fully-
     // balanced solution. Most-progress-wins: keep the snapshot with the most
@@ -1083,7 +1944,9 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
         }
         return n;
     }
-    function saveCandidate(depth, reason) {
+    // rejectedAlt: the alternative a limit check rejected, or null when the
+    // search got stuck (only used by the trace)
+    function saveCandidate(depth, rejectedAlt) {
         if (bestCandidate) {
             const oldSize = bestCandidate.variables.size;
             const newSize = context.variables.size;
@@ -1094,34 +1957,36 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
         bestCandidate = snapshotState(context, solveFailures, unsolvedEquations,
                                       erroredEquations, computedValues, errors, solved);
         bestCandidate.naturalness = naturalnessScore(context);
-        _trace(`  · candidate (depth ${depth}): ${reason}`);
+        if (rejectedAlt) _trace(TraceEvent.CANDIDATE_REJECTED, depth, rejectedAlt.variable, rejectedAlt.value, rejectedAlt);
+        else _trace(TraceEvent.CANDIDATE_STUCK, depth);
     }
 
     function solveRecursive(depth) {
         if (depth >= maxIterations) return 'none';
+        if (cancelToken) cancelToken.check();
         const myDepth = depth + 1;
-        _trace(`--- Advance (depth ${myDepth}) ---`);
+        _trace(TraceEvent.ADVANCE, myDepth);
         const { substitutions, definitionSubs } = deterministicAdvance();
 
         const allSet = [...requiredVars].every(v => context.hasVariable(v));
         if (allSet) {
             if (checkAllEquationsBalance(context, equations, record, places, requiredVars, erroredEquations)) {
-                _trace(`  ✓ balanced (depth ${myDepth})`);
+                _trace(TraceEvent.BALANCED, myDepth);
                 return 'balanced';
             }
             // Fall through to branching; the stuck-save below will catch this
             // state (branching won't yield anything when allSet is true).
         }
 
-        _trace(`  [5] Branching (depth ${myDepth})`);
+        _trace(TraceEvent.BRANCHING, myDepth);
         let anyAlt = false;
-        for (const alt of enumerateAlternatives(substitutions, definitionSubs)) {
+        for (const alt of branchAlternatives(substitutions, definitionSubs)) {
             anyAlt = true;
             const snap = snapshotState(context, solveFailures, unsolvedEquations,
                                        erroredEquations, computedValues, errors, solved);
 
-            _trace(`    Try ${alt.kind}: ${alt.variable} = ${alt.value} (${alt.sourceLabel})`);
-            for (const line of buildAttemptTraceLines(alt)) _trace(line);
+            if (_profile !== null) _profileBranch(alt, 'branchesTried');
+            _trace(TraceEvent.TRY, -1, alt.variable, alt.value, alt);
 
             if (!applyDecision(alt)) {
                 // applyDirectValue rejected the value (limit failure). The branch
@@ -1130,38 +1995,65 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
                 // state eagerly (the solveFailures entry would otherwise be
                 // wiped by the restoreState call below) so the user still sees
                 // the "outside limits" error, then skip the recursion.
-                saveCandidate(myDepth, `rejected by limit check: ${alt.variable} = ${alt.value}`);
+                saveCandidate(myDepth, alt);
                 solved = restoreState(context, solveFailures, unsolvedEquations,
                                       erroredEquations, computedValues, errors, snap);
-                _trace(`    Rejected: ${alt.variable} = ${alt.value} (limit check)`);
+                if (_profile !== null) _profileBranch(alt, 'branchesRestored');
+                _trace(TraceEvent.REJECTED_LIMIT, -1, alt.variable, alt.value, alt);
                 continue;
             }
 
+            path.push(alt);
             if (solveRecursive(myDepth) === 'balanced') return 'balanced';
+            path.pop();
 
             solved = restoreState(context, solveFailures, unsolvedEquations,
                                   erroredEquations, computedValues, errors, snap);
-            _trace(`    Rejected: ${alt.variable} = ${alt.value} (downstream failed)`);
+            if (_profile !== null) _profileBranch(alt, 'branchesRestored');
+            _trace(TraceEvent.REJECTED_DOWNSTREAM, -1, alt.variable, alt.value, alt);
         }
-        if (!anyAlt) _trace(`    (no alternatives available)`);
+        if (!anyAlt) _trace(TraceEvent.NO_ALTERNATIVES);
 
         // Fallback save: if no eager save fired during this invocation and
         // nothing reached 'balanced' downstream, capture the post-advance state
         // as a last-resort candidate. First-wins ensures the deepest such call
         // (which unwinds first in DFS order) captures the most-progressed state.
-        saveCandidate(myDepth, 'no balanced branch found');
+        saveCandidate(myDepth, null);
         return 'none';
     }
 
-    const status = solveRecursive(0);
+    // A timeout unwinds from wherever the search was (mid-branch, or inside
+    // a lazily-refined root sequence); fall back to the best candidate like
+    // an exhausted search, or keep the current state when there is none.
+    let status, timeout = null;
+    try {
+        status = solveRecursive(0);
+    } catch (e) {
+        if (!(e instanceof SolveTimeoutError)) throw e;
+        status = 'timeout';
+        timeout = e;
+        _trace(TraceEvent.TIMED_OUT, -1, null, NaN, e.message);
+    }
     if (status !== 'balanced' && bestCandidate) {
         // No perfectly-balanced branch was found. Fall back to the first state
         // in which all unknowns were bound so error reporting uses real values.
         solved = restoreState(context, solveFailures, unsolvedEquations,
                               erroredEquations, computedValues, errors, bestCandidate);
-        _trace(`========== solveEquations fell back to candidate (no balanced branch) ==========`);
+        _trace(TraceEvent.FELL_BACK);
     } else if (status !== 'balanced') {
-        _trace(`========== solveEquations FAILED (no complete solution) ==========`);
+        _trace(TraceEvent.FAILED);
+    }
+    // After the fallback restore, which would otherwise drop it
+    if (timeout) errors.push(timeout.message);
+
+    if (plans && status === 'balanced') {
+        const steps = path.map(planStep);
+        if (!plan) plans.recorded++;
+        else if (steps.length === plan.length && steps.every((step, i) => step.key === plan[i].key)) plans.replayed++;
+        else plans.fellBack++;
+        plans.set(planKey, steps);
+    } else if (plan) {
+        plans.fellBack++;
     }
 
     // Report body definitions that still couldn't evaluate. Skipped for
@@ -1358,7 +2250,7 @@ function solveEquations(context, declarations, record = {}, equations, bodyDefin
         }
     }
 
-    return { computedValues, solved, errors, solveFailures, equationVarStatus };
+    return { computedValues, solved, errors, solveFailures, equationVarStatus, timedOut: timeout !== null };
 }
 
 /**
@@ -1390,6 +2282,108 @@ function validateLimits(declarations, context, errors) {
     }
 }
 
+/**
+ * Order body definitions so each one follows the definitions its expression
+ * reads, keeping document order otherwise, so a chain like `x: y`, `y: z*2`
+ * fires in one pass instead of one retry pass per link. Only reads of
+ * variables not yet known count (a definition reading a known variable gets
+ * that value in any order). Names defined more than once keep their
+ * definitions in document order, since which one fires first decides the value.
+ *
+ * Definitions on a dependency cycle (`a: b`, `b: a`) are found here too
+ * (Tarjan's strongly connected components); they stay in the order for the
+ * solver's sake — binding one variable of the cycle can still let the rest
+ * fire — and cycles maps each to its cycle's names for error messages.
+ *
+ * @returns {{ ordered: Array, cycles: Map }} cycles: definition → [names, …, first name again]
+ */
+function orderBodyDefinitions(bodyDefinitions, context) {
+    const byName = new Map();
+    for (const def of bodyDefinitions) {
+        if (!byName.has(def.name)) byName.set(def.name, []);
+        byName.get(def.name).push(def);
+    }
+    const single = (name) => byName.has(name) && byName.get(name).length === 1;
+    const deps = new Map(bodyDefinitions.map(def => [def, !def.ast || !single(def.name) ? [] :
+        [...findVariablesInAST(def.ast)]
+            .filter(v => v !== def.name && single(v) && !context.hasVariable(v))
+            .map(v => byName.get(v)[0])]));
+
+    const ordered = [];
+    const cycles = new Map();
+    const position = new Map(bodyDefinitions.map((def, i) => [def, i]));
+    const index = new Map(), low = new Map(), stack = [], onStack = new Set();
+    function enter(def) {
+        index.set(def, index.size);
+        low.set(def, index.get(def));
+        stack.push(def);
+        onStack.add(def);
+    }
+    // Depth-first on an explicit stack of [definition, next dep] frames, so a
+    // chain of thousands of definitions can't overflow the JS call stack
+    function visit(root) {
+        enter(root);
+        const frames = [[root, 0]];
+        while (frames.length > 0) {
+            const frame = frames[frames.length - 1];
+            const def = frame[0];
+            const defDeps = deps.get(def);
+            if (frame[1] < defDeps.length) {
+                const dep = defDeps[frame[1]++];
+                if (!index.has(dep)) {
+                    enter(dep);
+                    frames.push([dep, 0]);
+                } else if (onStack.has(dep)) {
+                    low.set(def, Math.min(low.get(def), index.get(dep)));
+                }
+                continue;
+            }
+            frames.pop();
+            if (frames.length > 0) {
+                const parent = frames[frames.length - 1][0];
+                low.set(parent, Math.min(low.get(parent), low.get(def)));
+            }
+            if (low.get(def) !== index.get(def)) continue;
+            const component = [];
+            let member;
+            do {
+                member = stack.pop();
+                onStack.delete(member);
+                component.push(member);
+            } while (member !== def);
+            component.sort((a, b) => position.get(a) - position.get(b));
+            ordered.push(...component);
+            if (component.length > 1) {
+                for (const start of component) cycles.set(start, shortestCycle(start, new Set(component)));
+            }
+        }
+    }
+    // Breadth-first back to `start` within its component
+    function shortestCycle(start, members) {
+        const previous = new Map();
+        const queue = [start];
+        while (queue.length > 0) {
+            const def = queue.shift();
+            for (const dep of deps.get(def)) {
+                if (!members.has(dep) || previous.has(dep)) continue;
+                previous.set(dep, def);
+                if (dep === start) {
+                    const names = [start.name];
+                    for (let d = previous.get(start); d !== start; d = previous.get(d)) names.push(d.name);
+                    names.push(start.name);
+                    return names.reverse();
+                }
+                queue.push(dep);
+            }
+        }
+        return [start.name];
+    }
+    for (const def of bodyDefinitions) {
+        if (!index.has(def)) visit(def);
+    }
+    return { ordered, cycles };
+}
+
 // Report body definitions that never fired. The check uses firedBodyDefs
 // rather than hasVariable: a body-def-bound var may have a solver-derived
 // value while the body def itself was never honored (e.g. `z: z+w` with w
@@ -1402,13 +2396,18 @@ function validateLimits(declarations, context, errors) {
 // to a component that hasn't run yet (or never will, from this component's
 // perspective), so evaluating it against an incomplete shared context would
 // spuriously report "Variable X has no value" — the same hazard validateLimits
-// defers for cross-component limit references.
+// defers for cross-component limit references. A definition on a cycle of
+// still-unbound variables is reported as circular rather than by whichever
+// variable evaluate() happened to trip over.
 function reportUnevaluableBodyDefs(bodyDefinitions, context, variables, errors) {
-    for (const { name, ast, exprText } of bodyDefinitions) {
+    const { cycles } = orderBodyDefinitions(bodyDefinitions, context);
+    for (const def of bodyDefinitions) {
+        const { name, ast, exprText } = def;
         if (!ast || context.firedBodyDefs.has(name)) continue;
         try { evaluate(ast, context); } catch (e) {
             const lineIndex = (variables.get(name) || {}).lineIndex;
-            errors.push(`Line ${(lineIndex != null ? lineIndex : 0) + 1}: Cannot evaluate "${exprText || name}" - ${e.message}`);
+            const reason = cycles.has(def) ? `circular definition (${cycles.get(def).join(' → ')})` : e.message;
+            errors.push(`Line ${(lineIndex != null ? lineIndex : 0) + 1}: Cannot evaluate "${exprText || name}" - ${reason}`);
         }
     }
 }
@@ -1488,21 +2487,23 @@ function partitionEquationsByComponent(equations, declarations, bodyDefinitions)
  *
  * Returns the same shape as solveEquations.
  */
-function solveEquationsByComponent(context, declarations, record, equations, bodyDefinitions = []) {
+function solveEquationsByComponent(context, declarations, record, equations, bodyDefinitions = [], cancelToken = _cancelToken) {
     const components = partitionEquationsByComponent(equations, declarations, bodyDefinitions);
     if (components.length <= 1) {
-        return solveEquations(context, declarations, record, equations, bodyDefinitions);
+        return solveEquations(context, declarations, record, equations, bodyDefinitions, false, cancelToken);
     }
-    _trace(`========== Partitioned into ${components.length} independent components ==========`);
+    _trace(TraceEvent.PARTITIONED, components.length);
     const merged = {
         computedValues: new Map(),
         solved: 0,
         errors: [],
         solveFailures: new Map(),
-        equationVarStatus: new Map()
+        equationVarStatus: new Map(),
+        timedOut: false
     };
     for (const compEqs of components) {
-        const result = solveEquations(context, declarations, record, compEqs, bodyDefinitions, /* skipLimitValidation */ true);
+        const result = solveEquations(context, declarations, record, compEqs, bodyDefinitions, /* skipLimitValidation */ true, cancelToken);
+        merged.timedOut = merged.timedOut || result.timedOut;
         for (const [k, v] of result.computedValues) merged.computedValues.set(k, v);
         merged.solved += result.solved;
         merged.errors.push(...result.errors);
@@ -1804,221 +2805,401 @@ function appendReferencesSection(text, context) {
  * @param {boolean} includeTableOutputs - If true, append "--- Table Outputs ---"
  *   section to the text. Defaults off so the section is opt-in per solve
  *   (e.g. via Shift+Solve).
+ * @param {boolean} profileMode - If true, count solver work per equation and
+ *   unknown and return it as result.profile (see summarizeProfile)
+ * @param {SolveCancelToken} [cancelToken] - Deadline for the whole solve
+ *   (equations, re-solves and tables). When it passes, the solve stops
+ *   cooperatively, keeps the best partial state, and returns timedOut: true
+ *   with a timeout error.
  */
-function solveRecord(text, context, record, parserTokens, skipTables = false, traceMode = false, includeTableOutputs = false) {
-    // Set up trace buffer for this solve (outer only — paused during table eval)
-    const prevTraceBuffer = _traceBuffer;
-    if (traceMode) _traceBuffer = [];
+function solveRecord(text, context, record, parserTokens, skipTables = false, traceMode = false, includeTableOutputs = false, profileMode = false, cancelToken = null) {
+    // Set up the trace ring for this solve: trace mode collects the outer
+    // solve in its own unbounded ring (tables go to the production ring)
+    const prevTraceRing = _traceRing;
+    if (traceMode) _traceRing = new TraceRing(256, false);
+    const prevProfile = _profile;
+    if (profileMode) _profile = _newProfile();
+    // Always replaced (not just when given): each solve runs under its own
+    // deadline only
+    const prevCancelToken = _cancelToken;
+    _cancelToken = cancelToken;
+    const profileStart = profileMode ? performance.now() : 0;
 
-    // Remove any existing references, trace, and table outputs sections before solving
-    text = removeReferencesSection(text);
+    try {
+        // Remove any existing references, trace, and table outputs sections before solving
+        text = removeReferencesSection(text);
+        const sourceLines = profileMode ? text.split('\n') : null;
+
+        let allTokens = parserTokens;
 
-    let allTokens = parserTokens;
-
-    // Capture pre-solve values (before they are cleared)
-    // These are available via the ? operator and as stale fallback for ~
-    context.preSolveValues = context.preSolveValues || capturePreSolveValues(text, allTokens);
-
-    // Detect table definitions and build skip set
-    const tableDefs = findTableDefinitions(text, allTokens);
-    const tableLines = new Set();
-    for (const td of tableDefs) {
-        for (let l = td.startLine; l <= td.endLine; l++) tableLines.add(l);
-    }
-    // Merge table lines into function def lines for equation skipping
-    if (context.localFunctionLines) {
-        for (const l of tableLines) context.localFunctionLines.add(l);
-    }
-
-    // Clear output variables and expression outputs so they become unknowns for solving
-    // Uses 'solve' mode to also clear persistent outputs (:> :>>)
-    const clearResult = clearVariables(text, 'solve', allTokens, tableLines.size > 0 ? tableLines : null);
-    text = clearResult.text;
-    allTokens = clearResult.allTokens;
-
-    // Clear usage tracking from any previous solve
-    context.clearUsageTracking();
-
-    // Pass 1: Variable Discovery (parses declarations, evaluates definitions)
-    const discovery = discoverVariables(text, context, record, allTokens, tableLines.size > 0 ? tableLines : null);
-    text = discovery.text;
-    allTokens = discovery.allTokens;
-    const declarations = discovery.declarations;
-    const errors = [...(context.functionErrors || []), ...discovery.errors];
-
-    // Save pre-solve variable state for tables. Captured BEFORE the outer
-    // equation solve so that equation-solved intermediates (e.g. `adjTemp`
-    // falling out of a chain of equations, or any unknown Brent's resolves
-    // for an OUTPUT decl) do NOT leak into the per-cell context — those are
-    // outer-iteration-specific and would be stale if the table iterates a
-    // var they depend on. Tables get only outer's input decls (`v: 5`,
-    // `v<- 5`, etc.); input decls with expression values (`v: x*2`) get
-    // synced back below after solveEquations evaluates them. This matches
-    // the design rule: input decls are constraints inherited by tables;
-    // intermediates and OUTPUT-decl results are not.
-    const preSolveVars = new Map(context.variables);
-
-    // Trace discovered variables (grouped by whether they have a known value)
-    if (_traceBuffer !== null) {
-        _trace('--- Variable discovery ---');
-        const withValue = [];
-        const unknown = [];
+        // Capture pre-solve values (before they are cleared)
+        // These are available via the ? operator and as stale fallback for ~
+        context.preSolveValues = context.preSolveValues || capturePreSolveValues(text, allTokens);
+
+        // Detect table definitions and build skip set
+        const tableDefs = findTableDefinitions(text, allTokens);
+        const tableLines = new Set();
+        for (const td of tableDefs) {
+            for (let l = td.startLine; l <= td.endLine; l++) tableLines.add(l);
+        }
+        // Merge table lines into function def lines for equation skipping
+        if (context.localFunctionLines) {
+            for (const l of tableLines) context.localFunctionLines.add(l);
+        }
+
+        // Clear output variables and expression outputs so they become unknowns for solving
+        // Uses 'solve' mode to also clear persistent outputs (:> :>>)
+        const clearResult = clearVariables(text, 'solve', allTokens, tableLines.size > 0 ? tableLines : null);
+        text = clearResult.text;
+        allTokens = clearResult.allTokens;
+
+        // Clear usage tracking from any previous solve
+        context.clearUsageTracking();
+
+        // Pass 1: Variable Discovery (parses declarations, evaluates definitions)
+        const discovery = discoverVariables(text, context, record, allTokens, tableLines.size > 0 ? tableLines : null);
+        text = discovery.text;
+        allTokens = discovery.allTokens;
+        const declarations = discovery.declarations;
+        const errors = [...(context.functionErrors || []), ...discovery.errors];
+
+        // Save pre-solve variable state for tables. Captured BEFORE the outer
+        // equation solve so that equation-solved intermediates (e.g. `adjTemp`
+        // falling out of a chain of equations, or any unknown Brent's resolves
+        // for an OUTPUT decl) do NOT leak into the per-cell context — those are
+        // outer-iteration-specific and would be stale if the table iterates a
+        // var they depend on. Tables get only outer's input decls (`v: 5`,
+        // `v<- 5`, etc.); input decls with expression values (`v: x*2`) get
+        // synced back below after solveEquations evaluates them. This matches
+        // the design rule: input decls are constraints inherited by tables;
+        // intermediates and OUTPUT-decl results are not.
+        const preSolveVars = new Map(context.variables);
+
+        // Trace discovered variables (grouped by whether they have a known value)
+        _trace(TraceEvent.DISCOVERY_HEADER);
+        const unknownNames = [];
+        let unknownCount = 0;
+        let knownHeader = false;
         for (const decl of declarations) {
-            if (context.hasVariable(decl.name)) {
-                withValue.push(`${decl.name} = ${context.getVariable(decl.name)}`);
-            } else {
-                unknown.push(decl.name);
+            if (!context.hasVariable(decl.name)) {
+                if (_traceDetailed()) unknownNames.push(decl.name);
+                unknownCount++;
+                continue;
             }
+            if (!knownHeader) _trace(TraceEvent.DISCOVERY_KNOWN_HEADER);
+            knownHeader = true;
+            _trace(TraceEvent.DISCOVERY_KNOWN, decl.lineIndex, decl.name, context.getVariable(decl.name));
         }
-        if (withValue.length > 0) {
-            _trace('  known:');
-            for (const line of withValue) _trace(`    ${line}`);
+        if (unknownCount > 0) {
+            _trace(TraceEvent.DISCOVERY_UNKNOWN, -1, null, NaN, _traceDetailed() ? unknownNames : _DROPPED_REF);
         }
-        if (unknown.length > 0) {
-            _trace(`  unknown: ${unknown.join(', ')}`);
+
+        // Find equations and expression outputs
+        const { equations: outerEquations, exprOutputs } = findEquationsAndOutputs(text, allTokens, context.localFunctionLines);
+        preParseEquations(outerEquations);
+
+        if (outerEquations.length > 0) {
+            _trace(TraceEvent.EQUATIONS_HEADER, outerEquations.length);
+            for (const eq of outerEquations) _trace(TraceEvent.EQUATION, eq.startLine, null, NaN, eq);
+        }
+
+        // Build body definitions from declarations that couldn't evaluate during discovery
+        // (e.g. x<- pmt*2 where pmt is equation-solved). solveEquations retries these.
+        const bodyDefinitions = [];
+        for (const decl of declarations) {
+            if (decl.valueTokens && decl.valueTokens.length > 0 &&
+                decl.value === null &&
+                decl.declaration.type !== VarType.OUTPUT) {
+                try {
+                    const exprText = tokensToText(decl.valueTokens).trim();
+                    bodyDefinitions.push({ name: decl.name, ast: parseTokens(decl.valueTokens), exprText });
+                } catch (e) {
+                    errors.push(`Line ${decl.lineIndex + 1}: Cannot evaluate "${tokensToText(decl.valueTokens).trim()}" - ${e.message}`);
+                }
+            }
         }
-    }
 
-    // Find equations and expression outputs
-    const { equations: outerEquations, exprOutputs } = findEquationsAndOutputs(text, allTokens, context.localFunctionLines);
-    preParseEquations(outerEquations);
+        // Pass 2: Equation Solving
+        const solveResult = solveEquationsByComponent(context, declarations, record, outerEquations, bodyDefinitions);
+        errors.push(...solveResult.errors);
 
-    if (_traceBuffer !== null && outerEquations.length > 0) {
-        _trace(`--- Equations (${outerEquations.length}) ---`);
-        for (const eq of outerEquations) {
-            const modTag = eq.modN ? ' [°=]' : '';
-            _trace(`  line ${eq.startLine + 1}${modTag}: ${eq.text.substring(0, 80)}`);
+        // Update preSolveVars with body definitions resolved by solveEquations
+        // (safe: these are INPUT definitions, not equation intermediates)
+        for (const { name } of bodyDefinitions) {
+            if (context.hasVariable(name)) preSolveVars.set(name, context.getVariable(name));
         }
-    }
 
-    // Build body definitions from declarations that couldn't evaluate during discovery
-    // (e.g. x<- pmt*2 where pmt is equation-solved). solveEquations retries these.
-    const bodyDefinitions = [];
-    for (const decl of declarations) {
-        if (decl.valueTokens && decl.valueTokens.length > 0 &&
-            decl.value === null &&
-            decl.declaration.type !== VarType.OUTPUT) {
+        // Re-solve each OUTPUT-with-limits via full pipeline. INPUT drives the main
+        // solve; OUTPUT-with-limits is a display instruction that does its own
+        // complete solve (fast path when main value is in limits). Each OUTPUT
+        // stores its result under `__resolvevar_${lineIndex}` so multiple outputs
+        // of the same variable with different limits produce distinct display values.
+        const computedValues = solveResult.computedValues;
+        for (const decl of declarations) {
+            if (decl.declaration.type !== VarType.OUTPUT) continue;
+            if (!decl.declaration.limits) continue;
+            const { value, reason, errors: reErrors } = resolveWithLimits(
+                decl.name, decl.declaration, outerEquations, declarations,
+                context, record, preSolveVars, decl.lineIndex);
+            errors.push(...reErrors);
+            if (reason === 'noEquation' && !solveResult.solveFailures.has(decl.name)) {
+                errors.push(`Line ${decl.lineIndex + 1}: No equation references '${decl.name}' — cannot apply limits`);
+            }
+            computedValues.set(`__resolvevar_${decl.lineIndex}`, value);
+        }
+
+        // Evaluate expression outputs
+        for (const output of exprOutputs) {
+            if (computedValues.has(`__exprout_${output.startLine}`)) continue;
+            if (!output.recalculates && output.valueTokens && output.valueTokens.length > 0) continue;
             try {
-                const exprText = tokensToText(decl.valueTokens).trim();
-                bodyDefinitions.push({ name: decl.name, ast: parseTokens(decl.valueTokens), exprText });
+                const ast = parseTokens(output.exprTokens);
+                const value = evaluate(ast, context);
+                computedValues.set(`__exprout_${output.startLine}`, {
+                    value, fullPrecision: output.fullPrecision,
+                    marker: output.marker, format: output.format, base: output.base
+                });
             } catch (e) {
-                errors.push(`Line ${decl.lineIndex + 1}: Cannot evaluate "${tokensToText(decl.valueTokens).trim()}" - ${e.message}`);
+                errors.push(`Line ${output.startLine + 1}: ${e.message}`);
             }
         }
-    }
 
-    // Pass 2: Equation Solving
-    const solveResult = solveEquationsByComponent(context, declarations, record, outerEquations, bodyDefinitions);
-    errors.push(...solveResult.errors);
+        // Pass 3: Format Output
+        const formatResult = formatOutput(text, declarations, context, computedValues, record, solveResult.solveFailures, outerEquations, exprOutputs);
+        text = formatResult.text;
+        errors.push(...formatResult.errors);
+
+        // Pass 4: Evaluate tables (after all normal solving is complete) — pause tracing
+        const tables = [];
+        if (!skipTables) {
+            const savedRing = _traceRing;
+            _traceRing = _productionTrace; // skip table internals in trace
+            const savedVars = new Map(context.variables);
+            const savedDeclared = new Set(context.declaredVariables);
+            for (const td of tableDefs) {
+                // Restore outer context so tables don't leak state to each other.
+                // Both `variables` and `declaredVariables` need restoring: setVariable
+                // adds to both, and `evaluate` distinguishes "no value" (declared) vs
+                // "undefined" (not declared) when reporting errors — leaking
+                // declaredVariables makes identical tables report different errors.
+                context.variables = new Map(savedVars);
+                context.declaredVariables = new Set(savedDeclared);
+                const tableResult = evaluateTable(td, context, record, outerEquations, preSolveVars);
+                errors.push(...tableResult.errors);
+                tables.push(tableResult);
+            }
+            context.variables = savedVars;
+            context.declaredVariables = savedDeclared;
+            _traceRing = savedRing;
+        }
+
+        // Pass 5: Append references section showing used constants and functions
+        // Skip for reference records (Constants, Functions, Default Settings)
+        const isInReferenceCategory = record.category === 'Reference';
+        if (!isInReferenceCategory) {
+            text = appendReferencesSection(text, context);
+        }
+
+        // Pass 6: Append trace section (before table outputs) and table outputs section
+        const trace = traceMode ? _traceRing.format() : null;
+        if (trace && trace.length > 0) {
+            text = appendTraceSection(text, trace);
+        }
+        if (includeTableOutputs) {
+            text = appendTableOutputsSection(text, tables);
+        }
+
+        const profile = profileMode
+            ? summarizeProfile(_profile, sourceLines, performance.now() - profileStart) : null;
+
+        // Dedup errors: main solve and each slow-path re-solve can produce
+        // overlapping messages (e.g. the same balance error surfacing from
+        // multiple OUTPUT-with-limits re-solves, or a slow-path message
+        // identical to one already pushed by main solve). Drop exact duplicates,
+        // then sort by source-line number so the displayed order matches the
+        // top-to-bottom order of the gutter markers in the editor. Errors
+        // without a `Line N:` prefix (none currently, but defensive) sort last.
+        // Array.prototype.sort is stable, so two errors on the same line keep
+        // their original insertion order.
+        const dedupedErrors = [...new Set(errors)];
+        dedupedErrors.sort((a, b) => {
+            const ma = a.match(/^Line (\d+):/);
+            const mb = b.match(/^Line (\d+):/);
+            const na = ma ? parseInt(ma[1], 10) : Infinity;
+            const nb = mb ? parseInt(mb[1], 10) : Infinity;
+            return na - nb;
+        });
 
-    // Update preSolveVars with body definitions resolved by solveEquations
-    // (safe: these are INPUT definitions, not equation intermediates)
-    for (const { name } of bodyDefinitions) {
-        if (context.hasVariable(name)) preSolveVars.set(name, context.getVariable(name));
+        const timedOut = solveResult.timedOut || tables.some(t => t.timedOut);
+        return { text, solved: solveResult.solved, errors: dedupedErrors, equationVarStatus: solveResult.equationVarStatus, tables, trace, profile, timedOut };
+    } finally {
+        // Restored even when the solve throws, so a failed solve can't leave
+        // its ring, profile or deadline behind for the next one
+        _traceRing = prevTraceRing;
+        _profile = prevProfile;
+        _cancelToken = prevCancelToken;
     }
+}
 
-    // Re-solve each OUTPUT-with-limits via full pipeline. INPUT drives the main
-    // solve; OUTPUT-with-limits is a display instruction that does its own
-    // complete solve (fast path when main value is in limits). Each OUTPUT
-    // stores its result under `__resolvevar_${lineIndex}` so multiple outputs
-    // of the same variable with different limits produce distinct display values.
-    const computedValues = solveResult.computedValues;
+/**
+ * Prepare a record for repeated solves with different input values
+ * (parameter sweeps). The record text is scanned once for the declarations
+ * of the named inputs; every other declared variable is an output. The
+ * prepared record carries its own SolvePlans, so later solves replay the
+ * branching decisions of earlier ones.
+ * @param {string} text - Record text
+ * @param {Object} record - Record settings (places, degreesMode, ...)
+ * @param {Object} parsedConstants - From parseConstantsRecord, or null
+ * @param {Object} parsedFunctions - From parseFunctionsRecord, or null
+ * @param {Array<string>} inputNames - Variables set per solve
+ * @returns {Object} Pass to solvePrepared
+ */
+function prepareRecord(text, record, parsedConstants, parsedFunctions, inputNames) {
+    text = removeReferencesSection(text);
+    const declarations = parseAllVariables(text, tokenize(text));
+    const inputs = inputNames.map(name => {
+        const decl = declarations.find(d => d.name === name);
+        if (!decl) throw new Error(`"${name}" is not declared in the record`);
+        if (decl.declaration.type !== VarType.INPUT) {
+            throw new Error(`"${name}" is not an input declaration (use name: or name<-)`);
+        }
+        return decl;
+    });
+    const outputNames = [];
     for (const decl of declarations) {
-        if (decl.declaration.type !== VarType.OUTPUT) continue;
-        if (!decl.declaration.limits) continue;
-        const { value, reason, errors: reErrors } = resolveWithLimits(
-            decl.name, decl.declaration, outerEquations, declarations,
-            context, record, preSolveVars, decl.lineIndex);
-        errors.push(...reErrors);
-        if (reason === 'noEquation' && !solveResult.solveFailures.has(decl.name)) {
-            errors.push(`Line ${decl.lineIndex + 1}: No equation references '${decl.name}' — cannot apply limits`);
-        }
-        computedValues.set(`__resolvevar_${decl.lineIndex}`, value);
-    }
-
-    // Evaluate expression outputs
-    for (const output of exprOutputs) {
-        if (computedValues.has(`__exprout_${output.startLine}`)) continue;
-        if (!output.recalculates && output.valueTokens && output.valueTokens.length > 0) continue;
-        try {
-            const ast = parseTokens(output.exprTokens);
-            const value = evaluate(ast, context);
-            computedValues.set(`__exprout_${output.startLine}`, {
-                value, fullPrecision: output.fullPrecision,
-                marker: output.marker, format: output.format, base: output.base
-            });
-        } catch (e) {
-            errors.push(`Line ${output.startLine + 1}: ${e.message}`);
-        }
+        if (!inputNames.includes(decl.name) && !outputNames.includes(decl.name)) outputNames.push(decl.name);
     }
+    return {
+        lines: text.split('\n'), record, parsedConstants, parsedFunctions,
+        inputs, outputNames, plans: new SolvePlans()
+    };
+}
 
-    // Pass 3: Format Output
-    const formatResult = formatOutput(text, declarations, context, computedValues, record, solveResult.solveFailures, outerEquations, exprOutputs);
-    text = formatResult.text;
-    errors.push(...formatResult.errors);
+/**
+ * Solve a prepared record with one set of input values. Each value is
+ * written into its input's declaration as text, so it may be a number or
+ * an expression; an empty value clears the input so it is solved for.
+ * @param {Object} prepared - From prepareRecord
+ * @param {Array<string>} values - One value per input, in input order
+ * @param {number} [timeoutMs] - Budget for the solve
+ * @param {Map} [warmStart] - Values from a nearby solve (e.g. the previous
+ *   sample), used as pre-solve values for variables the text leaves empty,
+ *   so root searches start from them the way a re-solve in the editor does
+ * @returns {{text: string, inputValues: Array, values: Array, errors: Array<string>, timedOut: boolean}}
+ *   text is the solved record; inputValues holds one entry per input and
+ *   values one per output name (undefined when unsolved)
+ */
+function solvePrepared(prepared, values, timeoutMs = Infinity, warmStart = null) {
+    const lines = prepared.lines.slice();
+    prepared.inputs.forEach((input, i) => {
+        const decl = input.declaration;
+        const commentInfo = { comment: decl.comment, commentUnquoted: decl.commentUnquoted };
+        lines[input.lineIndex] = buildOutputLine(lines[input.lineIndex], input.markerEndCol - 1, values[i], commentInfo);
+    });
+    const text = lines.join('\n');
+    const tokens = tokenize(text);
+    const context = createEvalContext(prepared.record, prepared.parsedConstants, prepared.parsedFunctions, text, tokens);
+    context.solvePlans = prepared.plans;
+    if (warmStart) {
+        const preSolveValues = capturePreSolveValues(text, tokens);
+        for (const [name, value] of warmStart) {
+            if (!preSolveValues.has(name)) preSolveValues.set(name, value);
+        }
+        context.preSolveValues = preSolveValues;
+    }
+    const result = solveRecord(text, context, prepared.record, tokens, true, false, false, false,
+        new SolveCancelToken(timeoutMs));
+    return {
+        text: result.text,
+        inputValues: prepared.inputs.map(input => context.getVariable(input.name)),
+        values: prepared.outputNames.map(name => context.getVariable(name)),
+        errors: result.errors,
+        timedOut: result.timedOut
+    };
+}
 
-    // Pass 4: Evaluate tables (after all normal solving is complete) — pause tracing
-    const tables = [];
-    if (!skipTables) {
-        const savedBuf = _traceBuffer;
-        _traceBuffer = null; // skip table internals in trace
-        const savedVars = new Map(context.variables);
-        const savedDeclared = new Set(context.declaredVariables);
-        for (const td of tableDefs) {
-            // Restore outer context so tables don't leak state to each other.
-            // Both `variables` and `declaredVariables` need restoring: setVariable
-            // adds to both, and `evaluate` distinguishes "no value" (declared) vs
-            // "undefined" (not declared) when reporting errors — leaking
-            // declaredVariables makes identical tables report different errors.
-            context.variables = new Map(savedVars);
-            context.declaredVariables = new Set(savedDeclared);
-            const tableResult = evaluateTable(td, context, record, outerEquations, preSolveVars);
-            errors.push(...tableResult.errors);
-            tables.push(tableResult);
-        }
-        context.variables = savedVars;
-        context.declaredVariables = savedDeclared;
-        _traceBuffer = savedBuf;
-    }
-
-    // Pass 5: Append references section showing used constants and functions
-    // Skip for reference records (Constants, Functions, Default Settings)
-    const isInReferenceCategory = record.category === 'Reference';
-    if (!isInReferenceCategory) {
-        text = appendReferencesSection(text, context);
-    }
-
-    // Pass 6: Append trace section (before table outputs) and table outputs section
-    const trace = (traceMode && _traceBuffer) ? _traceBuffer.slice() : null;
-    if (trace && trace.length > 0) {
-        text = appendTraceSection(text, trace);
-    }
-    if (includeTableOutputs) {
-        text = appendTableOutputsSection(text, tables);
-    }
-
-    // Restore previous trace buffer
-    _traceBuffer = prevTraceBuffer;
-
-    // Dedup errors: main solve and each slow-path re-solve can produce
-    // overlapping messages (e.g. the same balance error surfacing from
-    // multiple OUTPUT-with-limits re-solves, or a slow-path message
-    // identical to one already pushed by main solve). Drop exact duplicates,
-    // then sort by source-line number so the displayed order matches the
-    // top-to-bottom order of the gutter markers in the editor. Errors
-    // without a `Line N:` prefix (none currently, but defensive) sort last.
-    // Array.prototype.sort is stable, so two errors on the same line keep
-    // their original insertion order.
-    const dedupedErrors = [...new Set(errors)];
-    dedupedErrors.sort((a, b) => {
-        const ma = a.match(/^Line (\d+):/);
-        const mb = b.match(/^Line (\d+):/);
-        const na = ma ? parseInt(ma[1], 10) : Infinity;
-        const nb = mb ? parseInt(mb[1], 10) : Infinity;
-        return na - nb;
+/**
+ * Aggregate raw profile counters into per-equation and per-unknown rows,
+ * each sorted by function evaluations (most work first). The result is
+ * plain data, so JSON.stringify gives the JSON form of the report.
+ * @param {Object} raw - Counters collected during solveRecord
+ * @param {Array<string>} sourceLines - Record text lines, for equation labels
+ * @param {number} ms - Wall time of the solve
+ */
+function summarizeProfile(raw, sourceLines, ms) {
+    const fields = ['solves', 'evals', 'brentIterations', 'newtonSteps', 'expansions', 'branchesTried', 'branchesRestored', 'substitutions'];
+    const equations = new Map();
+    const unknowns = new Map();
+    const rowFor = (map, key, init) => {
+        let row = map.get(key);
+        if (!row) {
+            row = init;
+            for (const f of fields) row[f] = 0;
+            map.set(key, row);
+        }
+        return row;
+    };
+    const equationRow = line => rowFor(equations, line, {
+        line: line + 1, text: ((sourceLines && sourceLines[line]) || '').trim(),
+        unknowns: [], attempts: 0, ms: 0
     });
+    for (const [line, a] of raw.attempts) {
+        const row = equationRow(line);
+        row.attempts = a.attempts;
+        row.ms = Math.round(a.ms * 1000) / 1000;
+    }
+    for (const e of raw.entries.values()) {
+        const eqRow = equationRow(e.line);
+        const unkRow = rowFor(unknowns, e.variable, { name: e.variable });
+        for (const f of fields) {
+            eqRow[f] += e[f];
+            unkRow[f] += e[f];
+        }
+        if (!eqRow.unknowns.includes(e.variable)) eqRow.unknowns.push(e.variable);
+    }
+    const byWork = (a, b) => ((b.ms || 0) - (a.ms || 0)) || (b.evals - a.evals)
+        || (b.branchesTried - a.branchesTried) || (b.substitutions - a.substitutions);
+    return {
+        ms: Math.round(ms * 1000) / 1000,
+        substitutionBuilds: raw.substitutionBuilds,
+        maxSubstitutions: raw.maxSubstitutions,
+        branchesTried: raw.branchesTried,
+        branchesRestored: raw.branchesRestored,
+        equations: [...equations.values()].sort(byWork),
+        unknowns: [...unknowns.values()].sort(byWork)
+    };
+}
 
-    return { text, solved: solveResult.solved, errors: dedupedErrors, equationVarStatus: solveResult.equationVarStatus, tables, trace };
+/**
+ * Format a profile (from solveRecord's result.profile) as a text report:
+ * totals, then per-equation and per-unknown tables, heaviest first.
+ * @param {Object} profile
+ * @param {number} [limit] - Max rows per table
+ */
+function formatProfileReport(profile, limit = 20) {
+    const cols = [['attempts', 'calls'], ['ms', 'ms'], ['evals', 'evals'], ['brentIterations', 'brent'],
+        ['newtonSteps', 'newton'], ['expansions', 'expand'], ['branchesTried', 'tried'], ['branchesRestored', 'restored'],
+        ['substitutions', 'subs']];
+    const cell = v => v === undefined ? '' : typeof v === 'number' && !Number.isInteger(v) ? v.toFixed(1) : String(v);
+    const header = cs => cs.map(([, h]) => h.padStart(9)).join('');
+    const row = (cs, r) => cs.map(([k]) => cell(r[k]).padStart(9)).join('');
+    const unknownCols = cols.slice(2); // calls and ms are per equation
+    const out = [
+        `Solve profile: ${profile.ms.toFixed(1)} ms, ${profile.branchesTried} branches tried ` +
+        `(${profile.branchesRestored} restored), ${profile.substitutionBuilds} substitution builds ` +
+        `(max ${profile.maxSubstitutions} variables)`,
+        '',
+        `${'equation'.padEnd(40)}${header(cols)}`
+    ];
+    for (const r of profile.equations.slice(0, limit)) {
+        const label = `line ${r.line}: ${r.text}`;
+        out.push(`${(label.length > 38 ? label.slice(0, 37) + '…' : label).padEnd(40)}${row(cols, r)}`);
+    }
+    out.push('', `${'unknown'.padEnd(40)}${header(unknownCols)}`);
+    for (const r of profile.unknowns.slice(0, limit)) {
+        out.push(`${r.name.padEnd(40)}${row(unknownCols, r)}`);
+    }
+    return out.join('\n');
 }
 
 /**
@@ -2074,7 +3255,7 @@ function evaluateTable(tableDef, context, record, outerEquations, preSolveVars)
     }
 
     // Parse body lines: iterators, definitions, unknowns, outputs, equations
-    const bodyTokens = new Tokenizer(tableDef.bodyText).tokenize();
+    const bodyTokens = tokenize(tableDef.bodyText);
     const iterators = [];    // { name, startExpr, endExpr, stepExpr, header }
     const definitions = [];  // { name, exprText, limits }
     const unknowns = [];     // { name, limits }
@@ -2607,8 +3788,13 @@ function evaluateTable(tableDef, context, record, outerEquations, preSolveVars)
             errors.push(`Line ${tableDef.startLine}: Table exceeded ${maxRows} rows`);
         }
         const rowLimit = Math.min(totalRowCount, maxRows);
+        let timedOut = false;
 
         for (let rowCount = 0; rowCount < rowLimit; rowCount++) {
+            if (_tableDeadlinePassed(errors, tableDef, rowCount, 'rows')) {
+                timedOut = true;
+                break;
+            }
             // Decompose rowCount into per-iterator indices in lexicographic
             // order: last iterator's index changes fastest.
             let idx = rowCount;
@@ -2679,7 +3865,7 @@ function evaluateTable(tableDef, context, record, outerEquations, preSolveVars)
         const solveInfo = goodRows < totalRows ? { solved: goodRows, total: totalRows } : null;
         // Result payload wants an array (not the outer iteratorNames Set)
         const iteratorNameList = evaledIterators.map(it => it.name);
-        return { type, keyword, title: expandedTitle, columns, rows, rawRows, iteratorNames: iteratorNameList, formatOpts, fontSize, solveInfo, startLine: tableDef.startLine, endLine: tableDef.endLine, errors };
+        return { type, keyword, title: expandedTitle, columns, rows, rawRows, iteratorNames: iteratorNameList, formatOpts, fontSize, solveInfo, startLine: tableDef.startLine, endLine: tableDef.endLine, errors, timedOut };
     }
 
     // ==================== GRID (2D cell values) ====================
@@ -2724,10 +3910,15 @@ function evaluateTable(tableDef, context, record, outerEquations, preSolveVars)
     const formattedRowValues = [];
     const formattedColValues = [];
     let goodCells = 0, totalCells = 0;
+    let timedOut = false;
     for (let r = 0; r < rowValues.length; r++) {
         const gridRow = [];
         let currentRowHdr = null;
         for (let c = 0; c < colValues.length; c++) {
+            if (_tableDeadlinePassed(errors, tableDef, totalCells, 'cells')) {
+                timedOut = true;
+                break;
+            }
             context.preSolveValues = new Map();
             const { badVars, balanceFailed } = evaluateCell([
                 { name: iter1.name, value: rowValues[r] },
@@ -2775,6 +3966,11 @@ function evaluateTable(tableDef, context, record, outerEquations, preSolveVars)
                 rawRows.push([currentRowHdr, rawColHeaderValues[c], cellRaw]);
             }
         }
+        if (timedOut) {
+            // Drop the partial row so the grid stays rectangular
+            formattedRowValues.length = grid.length;
+            break;
+        }
         grid.push(gridRow);
     }
 
@@ -2788,7 +3984,7 @@ function evaluateTable(tableDef, context, record, outerEquations, preSolveVars)
         columns, formatOpts,
         cellHeader: cellVar ? cellVar.header : '',
         grid, fontSize,
-        startLine: tableDef.startLine, endLine: tableDef.endLine, errors
+        startLine: tableDef.startLine, endLine: tableDef.endLine, errors, timedOut
     };
     // For gridGraph, route through _renderGraph by emitting tableGraph's flat
     // rawRows shape. Force col 1 (col-header) as the grouping column by
@@ -2807,6 +4003,7 @@ function evaluateTable(tableDef, context, record, outerEquations, preSolveVars)
 // Export for use in other modules
 if (typeof module !== 'undefined' && module.exports) {
     module.exports = {
-        solveRecord, solveEquations, formatOutput, solveEquationInContext, findVariablesInAST, buildVariablesMap, appendTraceSection
+        solveRecord, solveEquations, formatOutput, solveEquationInContext, findVariablesInAST, buildVariablesMap, appendTraceSection,
+        formatProfileReport, recentSolveTrace, rootCacheStats, clearRootCache, SolvePlans, prepareRecord, solvePrepared
     };
 }
@@ -12,6 +12,53 @@ class SolverError extends Error {
     }
 }
 
+/**
+ * Raised when a solve passes its deadline or is cancelled. Unlike
+ * SolverError it never means "no root here": every catch on the solve path
+ * rethrows it, so the solve unwinds to solveEquations, which keeps the best
+ * partial state it has.
+ */
+class SolveTimeoutError extends Error {
+    constructor(message) {
+        super(message);
+        this.name = 'SolveTimeoutError';
+    }
+}
+
+/**
+ * Deadline and cancellation token for a solve, checked cooperatively in
+ * Brent's iterations, bracket expansion, the backtracking recursion and
+ * table row loops.
+ */
+class SolveCancelToken {
+    /**
+     * @param {number} [timeoutMs] - Budget from now; Infinity for cancel-only
+     */
+    constructor(timeoutMs = Infinity) {
+        this.timeoutMs = timeoutMs;
+        this.deadline = performance.now() + timeoutMs;
+        this.cancelled = false;
+    }
+
+    cancel() {
+        this.cancelled = true;
+    }
+
+    get expired() {
+        return this.cancelled || performance.now() > this.deadline;
+    }
+
+    /**
+     * Throw SolveTimeoutError if the deadline has passed or cancel() was called
+     */
+    check() {
+        if (this.cancelled) throw new SolveTimeoutError('Solve cancelled');
+        if (performance.now() > this.deadline) {
+            throw new SolveTimeoutError(`Solve timed out after ${this.timeoutMs} ms`);
+        }
+    }
+}
+
 /**
  * Brent's method for root finding (Van Wijngaarden-Dekker-Brent)
  * Finds x such that f(x) = 0 in the interval [a, b]
@@ -25,15 +72,33 @@ class SolverError extends Error {
  * @param {number} a - Lower bound
  * @param {number} b - Upper bound
  * @param {number} maxIter - Maximum iterations (default: 100)
+ * @param {Object} [stats] - Optional work counters; brentIterations is incremented
+ * @param {SolveCancelToken} [cancel] - Checked every iteration
+ * @param {Function} [df] - Optional x → [f(x), f'(x)]. When given, each step first
+ *                          tries Newton from the best endpoint, accepted only when it
+ *                          lands inside the bracket and shrinks at least as fast as
+ *                          Brent's own steps must; otherwise the step is Brent's.
  * @returns {number} Root value
  */
-function brent(f, a, b, maxIter = 100) {
+function brent(f, a, b, maxIter = 100, stats = null, cancel = null, df = null) {
     const EPS = Number.EPSILON;
     // Absolute function tolerance: residual within ~128 ULPs of zero
     const fTol = 128 * EPS;
 
+    // With df every evaluation also yields the derivative (last one in dLast)
+    let dLast = NaN;
+    if (df) {
+        f = (x) => {
+            const r = df(x);
+            dLast = r[1];
+            return r[0];
+        };
+    }
+
     let fa = f(a);
+    let da = dLast;
     let fb = f(b);
+    let db = dLast;
 
     // Check if either endpoint is already a root
     if (Math.abs(fa) <= fTol) return a;
@@ -52,6 +117,7 @@ function brent(f, a, b, maxIter = 100) {
     if (Math.abs(fa) < Math.abs(fb)) {
         [a, b] = [b, a];
         [fa, fb] = [fb, fa];
+        [da, db] = [db, da];
     }
 
     let c = a;
@@ -61,6 +127,8 @@ function brent(f, a, b, maxIter = 100) {
     let mflag = true;
 
     for (let iter = 0; iter < maxIter; iter++) {
+        if (stats) stats.brentIterations++;
+        if (cancel) cancel.check();
         // Relative bracket tolerance: scales with magnitude of root
         const bracketTol = 2 * EPS * Math.abs(b) + fTol;
 
@@ -74,35 +142,52 @@ function brent(f, a, b, maxIter = 100) {
             return b;
         }
 
-        let s;
+        let s = NaN;
+
+        // Safeguarded Newton step from b. A step below the bracket tolerance
+        // is pushed out to half of it, so that when the root is that close the
+        // next evaluation lands across it and the bracket collapses.
+        if (df && db !== 0 && isFinite(db)) {
+            let step = -fb / db;
+            if (Math.abs(step) < bracketTol / 2) step = Math.sign(step) * bracketTol / 2;
+            const limit = mflag ? Math.abs(b - c) : Math.abs(c - d);
+            if ((b + step - a) * step < 0 && Math.abs(step) < limit / 2) {
+                s = b + step;
+                mflag = false;
+                if (stats) stats.newtonSteps++;
+            }
+        }
+
+        if (isNaN(s)) {
+            if (fa !== fc && fb !== fc) {
+                // Inverse quadratic interpolation
+                s = (a * fb * fc) / ((fa - fb) * (fa - fc)) +
+                    (b * fa * fc) / ((fb - fa) * (fb - fc)) +
+                    (c * fa * fb) / ((fc - fa) * (fc - fb));
+            } else {
+                // Secant method
+                s = b - fb * (b - a) / (fb - fa);
+            }
 
-        if (fa !== fc && fb !== fc) {
-            // Inverse quadratic interpolation
-            s = (a * fb * fc) / ((fa - fb) * (fa - fc)) +
-                (b * fa * fc) / ((fb - fa) * (fb - fc)) +
-                (c * fa * fb) / ((fc - fa) * (fc - fb));
-        } else {
-            // Secant method
-            s = b - fb * (b - a) / (fb - fa);
-        }
-
-        // Conditions for accepting s (reject and use bisection if any are true)
-        // cond1: s is outside the interval between (3a+b)/4 and b
-        const cond1 = (s - (3 * a + b) / 4) * (s - b) > 0;
-        const cond2 = mflag && Math.abs(s - b) >= Math.abs(b - c) / 2;
-        const cond3 = !mflag && Math.abs(s - b) >= Math.abs(c - d) / 2;
-        const cond4 = mflag && Math.abs(b - c) < bracketTol;
-        const cond5 = !mflag && Math.abs(c - d) < bracketTol;
-
-        if (cond1 || cond2 || cond3 || cond4 || cond5) {
-            // Bisection method
-            s = (a + b) / 2;
-            mflag = true;
-        } else {
-            mflag = false;
+            // Conditions for accepting s (reject and use bisection if any are true)
+            // cond1: s is outside the interval between (3a+b)/4 and b
+            const cond1 = (s - (3 * a + b) / 4) * (s - b) > 0;
+            const cond2 = mflag && Math.abs(s - b) >= Math.abs(b - c) / 2;
+            const cond3 = !mflag && Math.abs(s - b) >= Math.abs(c - d) / 2;
+            const cond4 = mflag && Math.abs(b - c) < bracketTol;
+            const cond5 = !mflag && Math.abs(c - d) < bracketTol;
+
+            if (cond1 || cond2 || cond3 || cond4 || cond5) {
+                // Bisection method
+                s = (a + b) / 2;
+                mflag = true;
+            } else {
+                mflag = false;
+            }
         }
 
         const fs = f(s);
+        const ds = dLast;
         d = c;
         c = b;
         fc = fb;
@@ -110,15 +195,18 @@ function brent(f, a, b, maxIter = 100) {
         if (fa * fs < 0) {
             b = s;
             fb = fs;
+            db = ds;
         } else {
             a = s;
             fa = fs;
+            da = ds;
         }
 
         // Ensure |f(b)| <= |f(a)|
         if (Math.abs(fa) < Math.abs(fb)) {
             [a, b] = [b, a];
             [fa, fb] = [fb, fa];
+            [da, db] = [db, da];
         }
     }
 
@@ -136,6 +224,14 @@ function safeEval(f, x) {
     }
 }
 
+/**
+ * Evaluate f at every x: one call to the batch evaluator when there is one
+ * (xs → residuals, see solveEquation's batchF), else point by point.
+ */
+function evalPoints(f, xs, batchF = null) {
+    return batchF ? batchF(xs) : xs.map(x => safeEval(f, x));
+}
+
 /**
  * Find a bracket by expanding outward from a guess
  * Used when no explicit limits are provided
@@ -149,7 +245,7 @@ function safeEval(f, x) {
  * detection handles narrow zero crossings; expandFromGuess is the only
  * place that extends beyond that, so capping it here is sufficient.
  */
-function expandFromGuess(f, guess = 1) {
+function expandFromGuess(f, guess = 1, stats = null, cancel = null) {
     const FACTOR = 1.6;
     const MAX_TRIES = 50;
     const MAX_MAGNITUDE = 1e10;
@@ -161,6 +257,8 @@ function expandFromGuess(f, guess = 1) {
     let fb = safeEval(f, b);
 
     for (let i = 0; i < MAX_TRIES; i++) {
+        if (stats) stats.expansions++;
+        if (cancel) cancel.check();
         // Handle NaN/Infinity by shrinking toward midpoint
         if (!isFinite(fa)) {
             a = (a + b) / 2;
@@ -194,6 +292,70 @@ function expandFromGuess(f, guess = 1) {
     return null;
 }
 
+/**
+ * Multi-start bracket search for the no-limits fallback: evaluate one batch of
+ * log-spaced probes (two per decade, both signs) over the magnitudes the main
+ * scan didn't reach, between 1e-6 and 1e10, and return each new sign change
+ * between neighbouring points as { lo, hi, flo, fhi }, in the solver's root
+ * preference order — positive brackets nearest zero first, then non-positive
+ * ones by magnitude. `scanned` holds the main scan's points (x → f(x)); they
+ * join the probes so brackets can span the edge of the scan, but brackets
+ * between two scan points are the scan's own and are left out. Capped at 1e10
+ * for the same reason as expandFromGuess.
+ */
+function multiStartBrackets(f, scanned, stats = null, cancel = null, batchF = null) {
+    let lowest = Infinity, highest = 0;
+    for (const x of scanned.keys()) {
+        if (x !== 0) lowest = Math.min(lowest, Math.abs(x));
+        highest = Math.max(highest, Math.abs(x));
+    }
+    const points = [...scanned].map(([x, fx]) => ({ x, fx, probe: false }));
+    if (cancel) cancel.check();
+    const probes = [];
+    for (let k = -12; k <= 20; k++) {
+        const decade = Number('1e' + Math.floor(k / 2));
+        const m = k % 2 === 0 ? decade : decade * Math.sqrt(10);
+        if (m < lowest || m > highest) probes.push(m, -m);
+    }
+    if (stats) stats.expansions += probes.length;
+    const fxs = evalPoints(f, probes, batchF);
+    probes.forEach((x, i) => points.push({ x, fx: fxs[i], probe: true }));
+    const sorted = points.filter(p => !isNaN(p.fx)).sort((a, b) => a.x - b.x);
+    const positive = [], nonPositive = [];
+    for (let i = 0; i + 1 < sorted.length; i++) {
+        const lo = sorted[i], hi = sorted[i + 1];
+        if ((lo.probe || hi.probe) && lo.fx * hi.fx < 0) {
+            (lo.x >= 0 ? positive : nonPositive).push({ lo: lo.x, hi: hi.x, flo: lo.fx, fhi: hi.fx });
+        }
+    }
+    return [...positive, ...nonPositive.reverse()];
+}
+
+/**
+ * Find a tight bracket around a warm-start guess (typically the unknown's
+ * pre-solve value) inside [lo, hi]. The first half-width is one unit in the
+ * guess's last decimal place — a value read back from a rounded display is
+ * within that of the root when inputs haven't changed — and each retry widens
+ * it 100×. Returns [a, b], or null once a retry would reach lo or hi (the
+ * caller then searches [lo, hi] itself).
+ */
+function warmBracket(f, guess, lo, hi, stats = null, cancel = null) {
+    const text = String(Math.abs(guess));
+    const dot = text.indexOf('.');
+    let delta = text.includes('e') ? Math.abs(guess) * 1e-6
+        : dot < 0 ? 1 : Math.pow(10, dot - text.length + 1);
+    delta = Math.max(delta, 4 * Number.EPSILON * Math.abs(guess), Number.MIN_VALUE);
+    for (; guess - delta > lo && guess + delta < hi; delta *= 100) {
+        if (stats) stats.expansions++;
+        if (cancel) cancel.check();
+        const a = guess - delta, b = guess + delta;
+        const fa = safeEval(f, a), fb = safeEval(f, b);
+        if (fa * fb <= 0) return [a, b];
+        if (!isFinite(fa) || !isFinite(fb)) return null;
+    }
+    return null;
+}
+
 /**
  * Solve an equation for a single unknown variable
  *
@@ -201,13 +363,33 @@ function expandFromGuess(f, guess = 1) {
  * @param {Object} limits - Optional search limits { low, high }
  * @param {number} knownScale - Max magnitude of known variables (extends search range)
  * @param {number|null} modN - Modulus for °= equations (to reject wrapping discontinuities)
- * @param {Object} [options] - { allRoots: boolean }. When true, returns an ordered array
- *                             of all roots found instead of just the best one. Used by the
- *                             recursive solver to enumerate candidates for backtracking.
- * @returns {number|number[]} Solution value, or array of values when allRoots is true.
- *                            Ordering: positive roots ascending, then non-positive by |value|.
+ * @param {Object} [options] - { allRoots: boolean, intervalF: Function, derivativeF: Function,
+ *                             batchF: Function, guess: number, stats: Object, cancel: SolveCancelToken }.
+ *                             allRoots: when true, returns an ordered array of all roots
+ *                             found instead of just the best one. Used by the recursive
+ *                             solver to enumerate candidates for backtracking.
+ *                             intervalF: optional (lo, hi) → [min, max] | null enclosure of
+ *                             f over [lo, hi]; lets the limits grid scan skip segments
+ *                             proven free of roots and poles.
+ *                             derivativeF: optional x → [f(x), f'(x)]; enables Newton
+ *                             steps inside Brent's bracket (see brent).
+ *                             batchF: optional xs → residuals at every x (NaN where f
+ *                             would fail), used for the scan grids and probe batches.
+ *                             guess: optional warm start (the unknown's previous value).
+ *                             A bracket containing it is first narrowed around it
+ *                             (warmBracket), and the no-root fallback expands from it.
+ *                             stats: optional counters (brentIterations, newtonSteps, expansions)
+ *                             incremented as Brent's and bracket expansion run,
+ *                             including lazily after return.
+ *                             cancel: deadline token; SolveTimeoutError propagates out
+ *                             of the call and out of the lazily-refined iterable.
+ * @returns {number|Iterable<number>} Solution value, or when allRoots is true an iterable
+ *                            of all roots. Ordering: positive roots ascending, then
+ *                            non-positive by |value|. Roots past the first are refined
+ *                            lazily as the iterable is consumed.
  */
-function solveEquation(f, limits = null, knownScale = 0, modN = null, { allRoots = false } = {}) {
+function solveEquation(f, limits = null, knownScale = 0, modN = null, { allRoots = false, intervalF = null, derivativeF = null, batchF = null, guess = null, stats = null, cancel = null } = {}) {
+    if (cancel) cancel.check();
     const hasLimits = limits && isFinite(limits.low) && isFinite(limits.high);
     const fTol = 128 * Number.EPSILON;
 
@@ -241,16 +423,47 @@ function solveEquation(f, limits = null, knownScale = 0, modN = null, { allRoots
         ];
     }
 
+    // Interval pruning (limits only): bisect the grid by index and mark the
+    // interior points of every segment whose enclosure is finite and clear
+    // of [-fTol, fTol]. Those points can't be near-zeros, can't form a sign
+    // change with their neighbours, and aren't NaN — so the bracket scan over
+    // the remaining points finds exactly the same roots. Skipped for °=
+    // equations, whose residual is wrapped by modN after evaluation.
+    const skipped = (intervalF && hasLimits && !modN && testPoints.length > 16)
+        ? new Uint8Array(testPoints.length) : null;
+    let skippedCount = 0;
+    if (skipped) {
+        const prune = (i, j) => {
+            if (j - i < 2) return;
+            const r = intervalF(testPoints[i], testPoints[j]);
+            if (r && (r[0] > fTol || r[1] < -fTol)) {
+                skipped.fill(1, i + 1, j);
+                skippedCount += j - i - 1;
+                return;
+            }
+            if (j - i < 8) return;
+            const m = (i + j) >> 1;
+            prune(i, m);
+            prune(m, j);
+        };
+        prune(0, testPoints.length - 1);
+    }
+
     // Evaluate all points (filter NaN, keep ±Infinity for sign detection)
-    const values = testPoints
-        .map(x => ({ x, fx: safeEval(f, x) }))
-        .filter(v => !isNaN(v.fx));
+    const scanXs = skipped ? testPoints.filter((x, i) => !skipped[i]) : testPoints;
+    const scanFxs = evalPoints(f, scanXs, batchF);
+    let scanIndex = 0;
+    const evaluated = testPoints.map((x, i) => skipped && skipped[i] ? null : { x, fx: scanFxs[scanIndex++] });
+    let values = evaluated.filter(v => v !== null && !isNaN(v.fx));
 
     // Helper: run Brent's on a bracket and reject singularities / mod wraps.
     // Returns the accepted root or null.
     function tryBracket(lo, hi, floLim, fhiLim) {
         try {
-            const root = brent(f, lo, hi);
+            const warm = guess !== null && guess > Math.min(lo, hi) && guess < Math.max(lo, hi)
+                ? warmBracket(f, guess, Math.min(lo, hi), Math.max(lo, hi), stats, cancel) : null;
+            const root = warm ? brent(f, warm[0], warm[1], 100, stats, cancel, derivativeF)
+                : brent(f, lo, hi, 100, stats, cancel, derivativeF);
             if (!isFinite(root)) return null;
             const fRoot = safeEval(f, root);
             if (!isFinite(fRoot)) return null;
@@ -262,6 +475,7 @@ function solveEquation(f, limits = null, knownScale = 0, modN = null, { allRoots
             if (isFinite(maxEndpoint) && Math.abs(fRoot) > maxEndpoint) return null;
             return root;
         } catch (e) {
+            if (e instanceof SolveTimeoutError) throw e;
             return null;
         }
     }
@@ -275,22 +489,93 @@ function solveEquation(f, limits = null, knownScale = 0, modN = null, { allRoots
     // then-addition orderings can produce machine-epsilon residuals at some
     // grid points even when the function is mathematically constant — those
     // are noise, not real roots.
-    const roots = [];
+    //
+    // Candidates are collected in scan order: near-zero test points (exact
+    // values) and sign-change brackets (refined by Brent's when reached, see
+    // preferenceOrder below).
+    const candidates = [];
     const hasNonZero = values.some(v => Math.abs(v.fx) > fTol);
     for (let i = 0; i < values.length; i++) {
         // Near-zero at a finite test point (skip if function is identically zero)
         if (isFinite(values[i].fx) && Math.abs(values[i].fx) <= fTol && hasNonZero) {
-            roots.push(values[i].x);
+            candidates.push({ value: values[i].x, seq: candidates.length });
         }
         if (i < values.length - 1 && values[i].fx * values[i + 1].fx < 0) {
-            const root = tryBracket(values[i].x, values[i + 1].x, values[i].fx, values[i + 1].fx);
-            if (root !== null) roots.push(root);
+            candidates.push({
+                lo: values[i].x, hi: values[i + 1].x,
+                flo: values[i].fx, fhi: values[i + 1].fx,
+                seq: candidates.length
+            });
         }
     }
 
+    // Yield roots in preference order: smallest positive first, then smallest
+    // absolute. Brackets are disjoint sub-intervals of the scan, so a bracket's
+    // position orders its root against every other candidate without refining
+    // it: a root in (lo, hi] with lo > 0 sorts by lo, one in [lo, hi) with
+    // hi < 0 sorts by |hi|, and no other candidate lies strictly inside. Only
+    // brackets touching zero are refined up front, since their root's side
+    // (and the 0 / -0 tie order) isn't known until then. Sub-intervals the
+    // consumer never reaches are never refined — the backtracker usually
+    // accepts an early root, so later brackets' Brent's runs are skipped.
+    // The sequence is identical to refining every bracket and sorting.
+    function* preferenceOrder() {
+        const positive = [], nonPositive = [];
+        for (const c of candidates) {
+            if (c.value === undefined && c.lo <= 0 && c.hi >= 0) {
+                const root = tryBracket(c.lo, c.hi, c.flo, c.fhi);
+                if (root === null) continue;
+                c.value = root;
+            }
+            if (c.value !== undefined) {
+                (c.value > 0 ? positive : nonPositive).push(c);
+            } else {
+                (c.lo > 0 ? positive : nonPositive).push(c);
+            }
+        }
+        const byKey = keyOf => (a, b) => (keyOf(a) - keyOf(b))
+            || ((a.value === undefined) - (b.value === undefined))
+            || (a.seq - b.seq);
+        positive.sort(byKey(c => c.value !== undefined ? c.value : c.lo));
+        nonPositive.sort(byKey(c => Math.abs(c.value !== undefined ? c.value : c.hi)));
+        for (const c of [...positive, ...nonPositive]) {
+            if (c.value !== undefined) {
+                yield c.value;
+            } else {
+                const root = tryBracket(c.lo, c.hi, c.flo, c.fhi);
+                if (root !== null) yield root;
+            }
+        }
+    }
+
+    // When allRoots is true, return the ordered sequence so callers can
+    // enumerate alternatives in preference order (used by the recursive
+    // solver); the first root is found eagerly so failure still throws here.
+    const ordered = preferenceOrder();
+    const first = ordered.next();
+    if (!first.done) {
+        if (!allRoots) return first.value;
+        return (function* () {
+            yield first.value;
+            yield* ordered;
+        })();
+    }
+
+    // The near-tangent search below looks at the neighbours of the closest-
+    // to-zero point, so it needs the full grid: evaluate what pruning skipped.
+    if (skippedCount > 0) {
+        const restXs = testPoints.filter((x, i) => skipped[i]);
+        const restFxs = evalPoints(f, restXs, batchF);
+        let restIndex = 0;
+        values = evaluated
+            .map((v, i) => v || { x: testPoints[i], fx: restFxs[restIndex++] })
+            .filter(v => !isNaN(v.fx));
+    }
+
     // Near-tangent root detection: when the scan misses a narrow sign change,
     // do fine grid search near the closest-to-zero point
-    if (roots.length === 0 && values.length >= 2) {
+    const roots = [];
+    if (values.length >= 2) {
         let bestI = 0;
         for (let i = 1; i < values.length; i++) {
             if (Math.abs(values[i].fx) < Math.abs(values[bestI].fx)) bestI = i;
@@ -302,11 +587,14 @@ function solveEquation(f, limits = null, knownScale = 0, modN = null, { allRoots
             if (bestI < values.length - 1) intervals.push([values[bestI].x, values[bestI + 1].x]);
             for (const [lo, hi] of intervals) {
                 const step = (hi - lo) / 100;
-                let prevX = lo, prevFx = safeEval(f, lo);
+                const fineXs = [lo];
+                for (let j = 1; j <= 100; j++) fineXs.push(lo + j * step);
+                const fineFxs = batchF ? batchF(fineXs) : null;
+                let prevX = lo, prevFx = fineFxs ? fineFxs[0] : safeEval(f, lo);
                 let found = false;
                 for (let j = 1; j <= 100 && !found; j++) {
-                    const x = lo + j * step;
-                    const fx = safeEval(f, x);
+                    const x = fineXs[j];
+                    const fx = fineFxs ? fineFxs[j] : safeEval(f, x);
                     if (isFinite(prevFx) && isFinite(fx) && prevFx * fx < 0) {
                         const root = tryBracket(prevX, x, prevFx, fx);
                         if (root !== null) {
@@ -322,30 +610,43 @@ function solveEquation(f, limits = null, knownScale = 0, modN = null, { allRoots
         }
     }
 
-    // Return roots: prefer smallest positive, then smallest absolute.
-    // When allRoots is true, return the full ordered list so callers can
-    // enumerate alternatives in preference order (used by the recursive solver).
+    // Near-tangent search stops at the first root it finds
     if (roots.length > 0) {
-        const positive = roots.filter(r => r > 0).sort((a, b) => a - b);
-        const nonPositive = roots.filter(r => r <= 0).sort((a, b) => Math.abs(a) - Math.abs(b));
-        const ordered = [...positive, ...nonPositive];
-        return allRoots ? ordered : ordered[0];
+        return allRoots ? roots : roots[0];
     }
 
-    // Fallback for no-limits: expand outward from default guess.
-    // Apply the same pole/singularity rejection so wide brackets spanning
-    // a pole don't produce a bogus "root" at the discontinuity.
-    // For mod-aware (°=) equations, skip expandFromGuess entirely: these
+    // Fallback for no-limits: brackets from a multi-start probe batch over the
+    // magnitudes the scan didn't cover (multiStartBrackets) and from expansion
+    // outward from the warm-start guess (or 1), tried in preference order —
+    // positive nearest zero first, then non-positive by magnitude. Apply the same pole/singularity rejection so
+    // wide brackets spanning a pole don't produce a bogus "root" at the
+    // discontinuity. The probe batch is skipped for a function identically
+    // zero on the scan (its rounding noise would fake sign changes, see
+    // hasNonZero).
+    // For mod-aware (°=) equations, skip the fallback entirely: these
     // equations involve trig functions whose argument reduction loses all
     // precision at large magnitudes (Math.sin at 1e18 is noise), producing
     // garbage "roots". The main scan + near-tangent detection already
     // cover [-1e8, 1e8] which is more than enough for any periodic equation.
     if (!hasLimits && !modN) {
-        const bracket = expandFromGuess(f);
-        if (bracket) {
-            const fa = safeEval(f, bracket[0]);
-            const fb = safeEval(f, bracket[1]);
-            const root = tryBracket(bracket[0], bracket[1], fa, fb);
+        const brackets = hasNonZero ? multiStartBrackets(f, new Map(values.map(v => [v.x, v.fx])), stats, cancel, batchF) : [];
+        const expanded = expandFromGuess(f, guess !== null && guess !== 0 ? guess : 1, stats, cancel);
+        if (expanded) {
+            const b = { lo: expanded[0], hi: expanded[1], flo: safeEval(f, expanded[0]), fhi: safeEval(f, expanded[1]) };
+            // Which side of zero a straddling bracket's root is on is only
+            // known once it is refined
+            if (b.lo < 0 && b.hi > 0) {
+                b.value = tryBracket(b.lo, b.hi, b.flo, b.fhi);
+                if (b.value !== null) brackets.push(b);
+            } else {
+                brackets.push(b);
+            }
+        }
+        const positive = b => b.value !== undefined ? b.value > 0 : b.lo >= 0;
+        const magnitude = b => Math.abs(b.value !== undefined ? b.value : b.lo >= 0 ? b.lo : b.hi);
+        brackets.sort((a, b) => (positive(b) - positive(a)) || (magnitude(a) - magnitude(b)));
+        for (const b of brackets) {
+            const root = b.value !== undefined ? b.value : tryBracket(b.lo, b.hi, b.flo, b.fhi);
             if (root !== null) return allRoots ? [root] : root;
         }
     }
@@ -355,6 +656,123 @@ function solveEquation(f, limits = null, knownScale = 0, modN = null, { allRoots
         : 'Could not find a root');
 }
 
+/**
+ * Solve the linear system A·x = b by Gaussian elimination with partial
+ * pivoting. A is an array of n rows of length n; neither input is modified.
+ *
+ * @returns {Float64Array|null} Solution, or null when A is singular
+ */
+function solveLinearSystem(A, b) {
+    const n = b.length;
+    const M = A.map(row => Float64Array.from(row));
+    const x = Float64Array.from(b);
+    for (let k = 0; k < n; k++) {
+        let p = k;
+        for (let i = k + 1; i < n; i++) {
+            if (Math.abs(M[i][k]) > Math.abs(M[p][k])) p = i;
+        }
+        if (!(Math.abs(M[p][k]) > 0) || !isFinite(M[p][k])) return null;
+        if (p !== k) {
+            [M[p], M[k]] = [M[k], M[p]];
+            [x[p], x[k]] = [x[k], x[p]];
+        }
+        for (let i = k + 1; i < n; i++) {
+            const factor = M[i][k] / M[k][k];
+            if (factor === 0) continue;
+            for (let j = k; j < n; j++) M[i][j] -= factor * M[k][j];
+            x[i] -= factor * x[k];
+        }
+    }
+    for (let k = n - 1; k >= 0; k--) {
+        let s = x[k];
+        for (let j = k + 1; j < n; j++) s -= M[k][j] * x[j];
+        x[k] = s / M[k][k];
+    }
+    return x.every(isFinite) ? x : null;
+}
+
+/**
+ * Damped Newton's method for a system of m equations in n unknowns
+ * (F(x) = 0, m >= n). Each step solves J·dx = -F, or the normal equations
+ * JᵀJ·dx = -JᵀF when there are more equations than unknowns, then halves
+ * it until the sum of squared residuals drops enough (Armijo backtracking).
+ * Iterates are clamped to the bounds. Stops when the residual is exactly
+ * zero or the step is down to rounding; the caller decides whether the
+ * result balances.
+ *
+ * @param {Function} F - x → Float64Array of m residuals (NaN where one fails)
+ * @param {Function} FJ - x → { f, jac }: the residuals and the m×n Jacobian rows
+ * @param {Float64Array} x0 - Starting point
+ * @param {Object} [options] - { lower, upper: per-unknown bounds (±Infinity
+ *                             for none), maxIterations, stats (evals counted by
+ *                             the caller's F/FJ; newtonSteps incremented per
+ *                             iteration), cancel: SolveCancelToken }
+ * @returns {Float64Array|null} Final point, or null when the Jacobian is
+ *                              singular (at the final point too: a solution
+ *                              that isn't isolated is no answer) or no step
+ *                              reduces the residual
+ */
+function newtonSystem(F, FJ, x0, { lower = null, upper = null, maxIterations = 50, stats = null, cancel = null } = {}) {
+    const EPS = Number.EPSILON;
+    const n = x0.length;
+    const sumSquares = (f) => {
+        let s = 0;
+        for (let i = 0; i < f.length; i++) s += f[i] * f[i];
+        return s;
+    };
+    const clamp = (v, j) => Math.min(upper ? upper[j] : Infinity, Math.max(lower ? lower[j] : -Infinity, v));
+
+    // Newton direction, least squares when overdetermined; null when singular
+    const direction = (f, jac) => {
+        const neg = Array.from(f, v => -v);
+        if (f.length === n) return solveLinearSystem(jac, neg);
+        const A = [], b = new Float64Array(n);
+        for (let j = 0; j < n; j++) {
+            A.push(new Float64Array(n));
+            for (let i = 0; i < f.length; i++) {
+                b[j] += jac[i][j] * neg[i];
+                for (let k = 0; k < n; k++) A[j][k] += jac[i][j] * jac[i][k];
+            }
+        }
+        return solveLinearSystem(A, b);
+    };
+
+    let x = Float64Array.from(x0, clamp);
+    let { f, jac } = FJ(x);
+    let norm = sumSquares(f);
+    if (!isFinite(norm)) return null;
+
+    let converged = false;
+    for (let iter = 0; ; iter++) {
+        if (cancel) cancel.check();
+        // Also the final check: a singular Jacobian at a zero of F means the
+        // solution isn't isolated (e.g. an equation that holds for any value)
+        const dx = direction(f, jac);
+        if (!dx) return null;
+        if (converged || norm === 0 || iter === maxIterations) return x;
+        if (stats) stats.newtonSteps++;
+
+        // Backtrack until the residual decreases enough
+        let lambda = 1, next = null;
+        for (let k = 0; k < 40; k++, lambda /= 2) {
+            const trial = Float64Array.from(x, (v, j) => clamp(v + lambda * dx[j], j));
+            if (sumSquares(F(trial)) <= (1 - 2e-4 * lambda) * norm) {
+                next = trial;
+                break;
+            }
+        }
+
+        // Steps at rounding level can't reduce the residual any further
+        const atRounding = Array.from(dx).every((d, j) => Math.abs(lambda * d) <= 4 * EPS * Math.abs(x[j]));
+        if (!next) return atRounding ? x : null;
+        x = next;
+        ({ f, jac } = FJ(x));
+        norm = sumSquares(f);
+        if (!isFinite(norm)) return null;
+        converged = atRounding;
+    }
+}
+
 /**
  * Substitute variables in an AST with their definition expressions.
  *
@@ -615,10 +1033,95 @@ function invertOperation(op, result, other, varOnLeft) {
     }
 }
 
+/**
+ * Canonical structural key for an AST. Two ASTs with the same key evaluate
+ * identically in any context (source spelling such as number radix or
+ * whitespace is dropped; -0 is kept distinct from 0).
+ *
+ * @param {Object} node - AST node
+ * @param {Map} [memo] - Optional node → key cache for repeated calls on subtrees
+ * @returns {string}
+ */
+function astKey(node, memo = null) {
+    if (!node) return '_';
+    if (memo && memo.has(node)) return memo.get(node);
+    let k;
+    switch (node.type) {
+        case 'NUMBER':
+            k = Object.is(node.value, -0) ? '#-0' : '#' + node.value;
+            break;
+        case 'VARIABLE':
+            k = '$' + node.name;
+            break;
+        case 'UNARY_OP':
+            k = '(' + node.op + ' ' + astKey(node.operand, memo) + ')';
+            break;
+        case 'POSTFIX_OP':
+            k = '(' + astKey(node.operand, memo) + ' ' + node.op + ')';
+            break;
+        case 'BINARY_OP':
+            k = '(' + astKey(node.left, memo) + ' ' + node.op + ' ' + astKey(node.right, memo) + ')';
+            break;
+        case 'FUNCTION_CALL':
+            k = node.name.toLowerCase() + '(' + node.args.map(a => astKey(a, memo)).join(';') + ')';
+            break;
+        case 'SHARED':
+            k = astKey(node.expr, memo);
+            break;
+        default:
+            k = '?' + node.type;
+    }
+    if (memo) memo.set(node, k);
+    return k;
+}
+
+// Derived isolations depend only on an equation's structure and on which of
+// its variables are known, not on their values — so they're cached across
+// solves, table rows, and records sharing the same equations. Keyed by
+// structure key + known-variable mask; bounded, least recently used evicted.
+const SUBSTITUTION_CACHE_LIMIT = 2000;
+const _substitutionCache = new Map();   // key → [{ variable, expressionAST }]
+const _equationStructure = new WeakMap(); // leftAST → { rightAST, key, vars }
+
+function equationStructure(leftAST, rightAST) {
+    let entry = _equationStructure.get(leftAST);
+    if (!entry || entry.rightAST !== rightAST) {
+        const vars = [...new Set([...findVariablesInAST(leftAST), ...findVariablesInAST(rightAST)])].sort();
+        entry = { rightAST, key: astKey(leftAST) + '=' + astKey(rightAST), vars };
+        _equationStructure.set(leftAST, entry);
+    }
+    return entry;
+}
+
+function cachedSubstitutions(context, leftAST, rightAST) {
+    if (!leftAST || !rightAST) return [];
+    const structure = equationStructure(leftAST, rightAST);
+    let mask = '';
+    for (const v of structure.vars) mask += context.hasVariable(v) ? '1' : '0';
+    const key = structure.key + '|' + mask;
+
+    let defs = _substitutionCache.get(key);
+    if (defs) {
+        _substitutionCache.delete(key); // refresh recency
+    } else {
+        defs = [...deriveSubstitutions(context, leftAST, rightAST)];
+        if (_substitutionCache.size >= SUBSTITUTION_CACHE_LIMIT) {
+            _substitutionCache.delete(_substitutionCache.keys().next().value);
+        }
+    }
+    _substitutionCache.set(key, defs);
+    return defs;
+}
+
+function clearSubstitutionCache() {
+    _substitutionCache.clear();
+}
+
 /**
  * Build a substitution map from definition equations
  * Only includes definitions where the variable has no value in context
- * Now includes algebraically derived substitutions
+ * Now includes algebraically derived substitutions (cached by equation
+ * structure, see cachedSubstitutions)
  */
 function buildSubstitutionMap(equations, context) {
     const substitutions = new Map();
@@ -626,14 +1129,15 @@ function buildSubstitutionMap(equations, context) {
     for (const eq of equations) {
         // Enumerate every algebraically derivable sub from this equation.
         // Both LHS and RHS are explored (see deriveSubstitutions, which
-        // swallows inversion errors internally).
+        // swallows inversion errors internally). Derived ASTs are shared
+        // between cache hits and never mutated.
         //
         // Cycles in the resulting sub map are allowed — e.g. `x = z/2`
         // yields both `x → z/2` and `z → 2*x`, which reference each
         // other. substituteInAST's cycle guard handles the runtime
         // termination; subset-enumerated Kind 3 combos prefer applying
         // one direction at a time over both together.
-        for (const def of deriveSubstitutions(context, eq.leftAST, eq.rightAST)) {
+        for (const def of cachedSubstitutions(context, eq.leftAST, eq.rightAST)) {
             if (context.hasVariable(def.variable)) continue;
             const sub = { ast: def.expressionAST, sourceLine: eq.startLine, modN: !!eq.modN };
             if (substitutions.has(def.variable)) {
@@ -687,15 +1191,251 @@ function findVariablesInAST(node) {
     return vars;
 }
 
+/**
+ * Specialize an equation for repeated evaluation while solving for a single
+ * unknown. Brent's and the grid scans call f(x) hundreds of times with only
+ * the unknown changing, so two rewrites are made once per solve target:
+ *
+ * - Constant folding: every maximal subtree that doesn't depend on the
+ *   unknown is evaluated once and replaced by a NUMBER node. Subtrees that
+ *   throw are left in place so f(x) still fails the same way. rand()/now()
+ *   (directly or via a user function) are never folded, and lazy operands
+ *   (if() branches, right side of && / ||) under an unknown-dependent parent
+ *   are left untouched so folding never evaluates something f(x) might not.
+ * - Common subexpressions: unknown-dependent subtrees occurring more than
+ *   once across both sides (e.g. `(1 + mint)**n` in the TVM payment formula
+ *   when solving for mint) are wrapped in SHARED nodes. evaluate() memoizes
+ *   them in context.sharedValues, which the caller resets per f(x) call.
+ *
+ * Arithmetic and evaluation order are unchanged, so f(x) returns exactly
+ * what it would for the original ASTs. The input ASTs are not mutated.
+ *
+ * @param {Object} leftAST - Left side of the equation
+ * @param {Object} rightAST - Right side of the equation
+ * @param {string} unknown - The variable being solved for
+ * @param {EvalContext} context - Context holding every other variable
+ * @returns {{ leftAST: Object, rightAST: Object, sharedCount: number }}
+ */
+function specializeForUnknown(leftAST, rightAST, unknown, context) {
+    const BINDING_FNS = new Set(['sum', 'prod']);
+    const VOLATILE_FNS = new Set(['rand', 'now']);
+    const volatileUserFns = new Map();
+    // Fold in a clone so builtins see the same context f(x) gives them
+    const foldCtx = context.clone();
+
+    // Does a user function (transitively) call rand() or now()? `visiting`
+    // maps the functions being checked to their depth. A call back into one
+    // of them answers false for now, so a false found below a cycle's entry
+    // is partial (the entry's other callees aren't checked yet): it's cached
+    // only when the cycles it met all return to the function itself.
+    let cycleDepth = Infinity; // shallowest `visiting` function met so far
+    function isVolatileFunction(name, visiting = new Map()) {
+        if (volatileUserFns.has(name)) return volatileUserFns.get(name);
+        const func = context.userFunctions.get(name);
+        if (!func) return false;
+        if (visiting.has(name)) {
+            cycleDepth = Math.min(cycleDepth, visiting.get(name));
+            return false;
+        }
+        // Precomputed for reference functions (compileReferenceContext)
+        if (func.volatile !== undefined) return func.volatile;
+        const depth = visiting.size;
+        const outerCycleDepth = cycleDepth;
+        cycleDepth = Infinity;
+        visiting.set(name, depth);
+        const result = callsVolatile(func.body, visiting);
+        visiting.delete(name);
+        if (result || cycleDepth >= depth) {
+            volatileUserFns.set(name, result);
+            cycleDepth = outerCycleDepth;
+        } else {
+            cycleDepth = Math.min(cycleDepth, outerCycleDepth);
+        }
+        return result;
+    }
+
+    function callsVolatile(n, visiting) {
+        if (!n) return false;
+        switch (n.type) {
+            case 'BINARY_OP':
+                return callsVolatile(n.left, visiting) || callsVolatile(n.right, visiting);
+            case 'UNARY_OP':
+                return callsVolatile(n.operand, visiting);
+            case 'FUNCTION_CALL': {
+                const name = n.name.toLowerCase();
+                if (context.userFunctions.has(name)) {
+                    if (isVolatileFunction(name, visiting)) return true;
+                } else if (VOLATILE_FNS.has(name)) {
+                    return true;
+                }
+                return n.args.some(arg => callsVolatile(arg, visiting));
+            }
+            default:
+                return false;
+        }
+    }
+
+    // Replace a known, pure subtree with its value (or keep it if it throws)
+    function toConstant(n) {
+        if (n.type === 'NUMBER') return n;
+        try {
+            return { type: 'NUMBER', value: evaluate(n, foldCtx) };
+        } catch (e) {
+            return n;
+        }
+    }
+
+    // Returns { node, dep, vol }. Known pure subtrees come back unchanged
+    // (dep and vol false) so the nearest impure or dependent ancestor folds
+    // them whole; other nodes are rebuilt with their pure children folded.
+    function fold(n, varying, lazy) {
+        if (!n) return { node: n, dep: false, vol: false };
+        switch (n.type) {
+            case 'VARIABLE':
+                return { node: n, dep: varying.has(n.name), vol: false };
+            case 'UNARY_OP': {
+                const r = fold(n.operand, varying, lazy);
+                if (!r.dep && !r.vol) return { node: n, dep: false, vol: false };
+                const operand = lazy ? n.operand : (r.dep || r.vol ? r.node : toConstant(r.node));
+                return { node: { type: 'UNARY_OP', op: n.op, operand }, dep: r.dep, vol: r.vol };
+            }
+            case 'BINARY_OP': {
+                const shortCircuit = n.op === '&&' || n.op === '||';
+                const l = fold(n.left, varying, lazy);
+                const r = fold(n.right, varying, lazy || shortCircuit);
+                const dep = l.dep || r.dep, vol = l.vol || r.vol;
+                if (!dep && !vol) return { node: n, dep, vol };
+                const pick = (c, orig, lz) => lz ? orig : (c.dep || c.vol ? c.node : toConstant(c.node));
+                return {
+                    node: {
+                        type: 'BINARY_OP', op: n.op,
+                        left: pick(l, n.left, lazy),
+                        right: pick(r, n.right, lazy || shortCircuit)
+                    },
+                    dep, vol
+                };
+            }
+            case 'FUNCTION_CALL': {
+                const name = n.name.toLowerCase();
+                const isUser = context.userFunctions.has(name);
+                const binding = !isUser && BINDING_FNS.has(name) && n.args.length === 4
+                    && n.args[1] && n.args[1].type === 'VARIABLE';
+                const isIf = !isUser && name === 'if';
+                const results = n.args.map((arg, i) => {
+                    if (binding && i === 1) return { node: arg, dep: true, vol: false, keep: true };
+                    if (binding && i === 0) {
+                        const inner = new Set(varying);
+                        inner.add(n.args[1].name);
+                        return fold(arg, inner, lazy);
+                    }
+                    return fold(arg, varying, lazy || (isIf && i > 0));
+                });
+                let dep = false;
+                let vol = isUser ? isVolatileFunction(name) : VOLATILE_FNS.has(name);
+                results.forEach((r, i) => {
+                    if (binding && i === 1) return;
+                    dep = dep || r.dep;
+                    vol = vol || r.vol;
+                });
+                if (!dep && !vol) return { node: n, dep, vol };
+                const args = results.map((r, i) => {
+                    if (r.keep || lazy || (isIf && i > 0)) return n.args[i];
+                    return r.dep || r.vol ? r.node : toConstant(r.node);
+                });
+                return { node: { type: 'FUNCTION_CALL', name: n.name, args }, dep, vol };
+            }
+            default:
+                // NUMBER, and POSTFIX_OP (x~ is fixed for the whole solve)
+                return { node: n, dep: false, vol: false };
+        }
+    }
+
+    const varying = new Set([unknown]);
+    const folded = [leftAST, rightAST].map(ast => {
+        const r = fold(ast, varying, false);
+        return r.dep || r.vol ? r.node : toConstant(r.node);
+    });
+
+    // Structural keys, memoized per node object
+    const keys = new Map();
+    const counts = new Map();
+    const keyOf = n => astKey(n, keys);
+
+    // Count shareable subtrees; returns whether n calls rand()/now(), which
+    // must be re-evaluated at every occurrence.
+    function countShareable(n) {
+        if (!n) return false;
+        let vol;
+        switch (n.type) {
+            case 'BINARY_OP': {
+                const l = countShareable(n.left);
+                vol = countShareable(n.right) || l;
+                break;
+            }
+            case 'UNARY_OP':
+                vol = countShareable(n.operand);
+                break;
+            case 'FUNCTION_CALL': {
+                const name = n.name.toLowerCase();
+                vol = context.userFunctions.has(name)
+                    ? isVolatileFunction(name)
+                    : VOLATILE_FNS.has(name);
+                for (const arg of n.args) {
+                    if (countShareable(arg)) vol = true;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+        if (!vol) {
+            const k = keyOf(n);
+            counts.set(k, (counts.get(k) || 0) + 1);
+        }
+        return vol;
+    }
+    folded.forEach(countShareable);
+
+    const slots = new Map();
+    for (const [k, c] of counts) {
+        if (c > 1) slots.set(k, slots.size);
+    }
+    if (slots.size === 0) {
+        return { leftAST: folded[0], rightAST: folded[1], sharedCount: 0 };
+    }
+
+    function share(n) {
+        if (!n) return n;
+        let out;
+        switch (n.type) {
+            case 'BINARY_OP':
+                out = { type: 'BINARY_OP', op: n.op, left: share(n.left), right: share(n.right) };
+                break;
+            case 'UNARY_OP':
+                out = { type: 'UNARY_OP', op: n.op, operand: share(n.operand) };
+                break;
+            case 'FUNCTION_CALL':
+                out = { type: 'FUNCTION_CALL', name: n.name, args: n.args.map(share) };
+                break;
+            default:
+                return n;
+        }
+        const slot = keys.has(n) ? slots.get(keys.get(n)) : undefined;
+        return slot === undefined ? out : { type: 'SHARED', slot, expr: out };
+    }
+
+    return { leftAST: share(folded[0]), rightAST: share(folded[1]), sharedCount: slots.size };
+}
+
 // Import parseExpression and evaluate from other modules (will be available globally)
 // These will be set up when the modules are loaded together
 
 // Export for use in other modules
 if (typeof module !== 'undefined' && module.exports) {
     module.exports = {
-        SolverError, brent, expandFromGuess, solveEquation,
-        findVariablesInAST,
+        SolverError, SolveTimeoutError, SolveCancelToken, brent, expandFromGuess, solveEquation,
+        solveLinearSystem, newtonSystem, findVariablesInAST,
         substituteInAST, deepCopyAST, isDefinitionEquation,
-        invertOperation, buildSubstitutionMap
+        invertOperation, buildSubstitutionMap, specializeForUnknown, astKey, clearSubstitutionCache
     };
 }
@@ -497,6 +497,20 @@ function openRecord(recordId, { preview = false } = {}) {
     renderDetailsPanel();
 }
 
+// Last parse of each reference record, keyed by its text. Returning the same
+// parsed maps while the text is unchanged lets createEvalContext reuse one
+// compiled reference context (compileReferenceContext) across solves.
+const _referenceParses = { constants: { text: null, parsed: null }, functions: { text: null, parsed: null } };
+
+function parseReferenceRecord(slot, text, tokens, parse) {
+    const entry = _referenceParses[slot];
+    if (entry.text !== text) {
+        entry.parsed = parse(text, tokens);
+        entry.text = text;
+    }
+    return entry.parsed;
+}
+
 /**
  * Get reference constants and functions from the Constants and Functions records
  * @returns {{ constants: Set, functions: Set }}
@@ -513,7 +527,7 @@ function getReferenceInfo() {
         if (constantsRecord) {
             const editorInfo = UI.editors.get(constantsRecord.id);
             const tokens = editorInfo ? editorInfo.editor.parserTokens : null;
-            parsedConstants = parseConstantsRecord(constantsRecord.text, tokens);
+            parsedConstants = parseReferenceRecord('constants', constantsRecord.text, tokens, parseConstantsRecord);
             for (const name of parsedConstants.keys()) {
                 constantNames.add(name);
             }
@@ -524,7 +538,7 @@ function getReferenceInfo() {
         if (functionsRecord) {
             const editorInfo = UI.editors.get(functionsRecord.id);
             const tokens = editorInfo ? editorInfo.editor.parserTokens : null;
-            parsedFunctions = parseFunctionsRecord(functionsRecord.text, tokens);
+            parsedFunctions = parseReferenceRecord('functions', functionsRecord.text, tokens, parseFunctionsRecord);
             for (const name of parsedFunctions.keys()) {
                 functionNames.add(name.toLowerCase());
             }
@@ -1578,6 +1592,13 @@ async function handleReset() {
     setStatus(fullReset ? 'Reset to default records' : 'Refreshed built-in records', false, false);
 }
 
+/**
+ * Budget for one Solve (both passes, tables included). A runaway record —
+ * an exploding backtracking search or a huge table — stops here with its
+ * partial results and a timeout error instead of freezing the page.
+ */
+const SOLVE_TIME_LIMIT_MS = 20000;
+
 /**
  * Handle solve
  */
@@ -1621,7 +1642,7 @@ function handleSolve(undoable = true, traceMode = false, includeTableOutputs = f
         // solving a startText that differs from the editor, tokenize it fresh
         // (the editor's cached parserTokens describe its own value).
         const parserTokens = (startText != null)
-            ? new Tokenizer(text).tokenize()
+            ? tokenize(text)
             : editorInfo.editor.parserTokens;
         const context = createEvalContext(record,
             editorInfo.editor.parsedConstants, editorInfo.editor.parsedFunctions,
@@ -1630,22 +1651,28 @@ function handleSolve(undoable = true, traceMode = false, includeTableOutputs = f
         // Solve the record (captures pre-solve values and clears outputs internally)
         // First pass always skips tables — re-solve below computes them once
         // Trace flag enables a "--- Solve Trace ---" section for the outer solve
-        const result = solveRecord(text, context, record, parserTokens, true, traceMode, includeTableOutputs);
+        const cancelToken = new SolveCancelToken(SOLVE_TIME_LIMIT_MS);
+        const result = solveRecord(text, context, record, parserTokens, true, traceMode, includeTableOutputs, false, cancelToken);
         text = result.text;
 
         // Re-solve formatted output: idempotency check, rounding detection, table evaluation,
         // and a second chance when the first solve filled in cleared variables with balance errors
-        // (traceMode=false — re-solve strips the trace, we re-append the first-pass trace below)
-        const verifyTokens = new Tokenizer(text).tokenize();
-        const verifyContext = createEvalContext(record,
-            editorInfo.editor.parsedConstants, editorInfo.editor.parsedFunctions,
-            text, verifyTokens);
-        verifyContext.preSolveValues = context.preSolveValues; // preserve x~ values so counters don't double-increment
-        const verifyResult = solveRecord(text, verifyContext, record, verifyTokens, false, false, includeTableOutputs);
-        text = verifyResult.text;
+        // (traceMode=false — re-solve strips the trace, we re-append the first-pass trace below).
+        // Skipped when the first pass timed out: with the budget spent it would
+        // only clear the partial results the first pass found.
+        let verifyResult = result;
+        if (!result.timedOut) {
+            const verifyTokens = tokenize(text);
+            const verifyContext = createEvalContext(record,
+                editorInfo.editor.parsedConstants, editorInfo.editor.parsedFunctions,
+                text, verifyTokens);
+            verifyContext.preSolveValues = context.preSolveValues; // preserve x~ values so counters don't double-increment
+            verifyResult = solveRecord(text, verifyContext, record, verifyTokens, false, false, includeTableOutputs, false, cancelToken);
+            text = verifyResult.text;
+        }
 
         // Re-append solve trace from first pass (re-solve strips it)
-        if (traceMode && result.trace && result.trace.length > 0) {
+        if (traceMode && verifyResult !== result && result.trace && result.trace.length > 0) {
             text = appendTraceSection(text, result.trace);
         }
         let errors = verifyResult.errors;
@@ -1711,6 +1738,7 @@ function handleSolve(undoable = true, traceMode = false, includeTableOutputs = f
     } catch (err) {
         setStatus('Error: ' + err.message, true);
         console.error('Solve error:', err);
+        console.error('Last solve trace events:\n' + recentSolveTrace(50).join('\n'));
     }
 }
 
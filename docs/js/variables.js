@@ -516,7 +516,7 @@ function clearVariables(text, clearType = 'input', allTokens, skipLines) {
     }
 
     const newText = lines.join('\n');
-    const newTokens = new Tokenizer(newText).tokenize();
+    const newTokens = tokenize(newText);
     return { text: newText, allTokens: newTokens };
 }
 
@@ -775,7 +775,7 @@ function extractEquationFromLine(lineText, lineTokens, eqTok) {
  * Returns a map of constant name -> value
  */
 function parseConstantsRecord(text, allTokens) {
-    if (!allTokens) allTokens = new Tokenizer(text).tokenize();
+    if (!allTokens) allTokens = tokenize(text);
     const constants = new Map();
     const lines = text.split('\n');
     const tempContext = new EvalContext();
@@ -807,7 +807,7 @@ function parseConstantsRecord(text, allTokens) {
  * Walks the token stream directly — no line splitting, no comment stripping.
  */
 function parseFunctionsRecord(text, allTokens, knownFunctions) {
-    if (!allTokens) allTokens = new Tokenizer(text).tokenize();
+    if (!allTokens) allTokens = tokenize(text);
     const functions = new Map();
     const lineOffsets = computeLineOffsets(text);
     const maxLine = lineOffsets.length;
@@ -913,40 +913,142 @@ function parseFunctionsRecord(text, allTokens, knownFunctions) {
     }
 }
 
+// Compiled reference contexts: parsedConstants → parsedFunctions → compiled.
+// Keyed on the parsed maps' identity, so entries go away with them and a
+// re-parse (the record changed) compiles afresh.
+const _referenceContexts = new WeakMap();
+const _NO_REFERENCE = Object.freeze({});
+
+// Lowercased names of the functions a body calls
+function functionCallNames(node, names = new Set()) {
+    if (!node || typeof node !== 'object') return names;
+    if (Array.isArray(node)) {
+        for (const child of node) functionCallNames(child, names);
+        return names;
+    }
+    if (node.type === 'FUNCTION_CALL') names.add(node.name.toLowerCase());
+    for (const key in node) {
+        const child = node[key];
+        if (child && typeof child === 'object') functionCallNames(child, names);
+    }
+    return names;
+}
+
 /**
- * Create an EvalContext with constants and user functions loaded
- * @param {Object} record - Current record (uses record.degreesMode)
- * @param {Map} parsedConstants - Pre-parsed constants from parseConstantsRecord()
- * @param {Map} parsedFunctions - Pre-parsed functions from parseFunctionsRecord()
- * @param {string} localText - Optional text of current record for local function definitions
- * @param {Array} allTokens - Optional pre-tokenized tokens for localText
- * @returns {EvalContext} Configured evaluation context
+ * Build the read-only part of an evaluation context from the parsed Constants
+ * and Functions records: constant values and comments, parsed function bodies,
+ * and per-function dependencies (`calls`: functions called; `volatile`: whether
+ * it transitively calls rand() or now(), left undefined when that hinges on a
+ * function the reference records don't define, i.e. a record's local one).
+ *
+ * Built once per (parsedConstants, parsedFunctions) pair and shared by every
+ * context created from them, so a batch solving thousands of records against
+ * the same reference records parses each function body once. Entries are
+ * frozen and the maps are never mutated — createEvalContext copies the
+ * function map before adding a record's local functions.
+ *
+ * @returns {{ constants: Map, constantComments: Map, userFunctions: Map, functionErrors: Array }}
  */
-function createEvalContext(record, parsedConstants, parsedFunctions, localText = null, allTokens = null) {
-    const context = new EvalContext();
-    context.degreesMode = (record && record.degreesMode) || false;
-    context.places = (record && record.places != null) ? record.places : 4;
+function compileReferenceContext(parsedConstants, parsedFunctions) {
+    const constantsKey = parsedConstants || _NO_REFERENCE;
+    const functionsKey = parsedFunctions || _NO_REFERENCE;
+    let byFunctions = _referenceContexts.get(constantsKey);
+    if (!byFunctions) {
+        byFunctions = new WeakMap();
+        _referenceContexts.set(constantsKey, byFunctions);
+    }
+    const cached = byFunctions.get(functionsKey);
+    if (cached) return cached;
 
-    // Load constants (callers provide pre-parsed results from getReferenceInfo)
+    const constants = new Map();
+    const constantComments = new Map();
     if (parsedConstants) {
         for (const [name, { value, comment }] of parsedConstants) {
-            context.setConstant(name, value, comment);
+            constants.set(name, value);
+            if (comment) constantComments.set(name, comment);
         }
     }
 
-    // Load user functions (callers provide pre-parsed results from getReferenceInfo)
+    const userFunctions = new Map();
     const functionErrors = [];
     if (parsedFunctions) {
         for (const [name, { params, bodyText, sourceText }] of parsedFunctions) {
             try {
-                const bodyAST = parseExpression(bodyText);
-                context.setUserFunction(name, params, bodyAST, sourceText);
+                const body = parseExpression(bodyText);
+                userFunctions.set(name.toLowerCase(), { params, body, sourceText, calls: functionCallNames(body) });
             } catch (e) {
                 functionErrors.push(`Error in Functions record: ${name}() — ${e.message}`);
             }
         }
     }
 
+    // Volatility: rand/now reached through reference functions only. A call
+    // back into a function still being checked answers false for now, so a
+    // result found below a cycle's entry is partial and isn't cached unless
+    // it's true (see isVolatileFunction in solver.js).
+    const volatile = new Map();
+    let cycleDepth = Infinity;
+    const isVolatile = (name, visiting) => {
+        if (volatile.has(name)) return volatile.get(name);
+        if (visiting.has(name)) {
+            cycleDepth = Math.min(cycleDepth, visiting.get(name));
+            return false;
+        }
+        const depth = visiting.size;
+        const outerCycleDepth = cycleDepth;
+        cycleDepth = Infinity;
+        visiting.set(name, depth);
+        let result = false;
+        for (const callee of userFunctions.get(name).calls) {
+            const v = userFunctions.has(callee) ? isVolatile(callee, visiting)
+                : callee === 'rand' || callee === 'now' ? true
+                : (typeof builtinFunctions !== 'undefined' && builtinFunctions[callee] !== undefined) ? false
+                : undefined;
+            if (v === true) { result = true; break; }
+            if (v === undefined) result = undefined;
+        }
+        visiting.delete(name);
+        if (result === true || cycleDepth >= depth) {
+            volatile.set(name, result);
+            cycleDepth = outerCycleDepth;
+        } else {
+            cycleDepth = Math.min(cycleDepth, outerCycleDepth);
+        }
+        return result;
+    };
+    for (const [name, func] of userFunctions) {
+        func.volatile = isVolatile(name, new Map());
+        Object.freeze(func.calls);
+        Object.freeze(func);
+    }
+
+    const compiled = Object.freeze({ constants, constantComments, userFunctions, functionErrors: Object.freeze(functionErrors) });
+    byFunctions.set(functionsKey, compiled);
+    return compiled;
+}
+
+/**
+ * Create an EvalContext with constants and user functions loaded
+ * @param {Object} record - Current record (uses record.degreesMode)
+ * @param {Map} parsedConstants - Pre-parsed constants from parseConstantsRecord()
+ * @param {Map} parsedFunctions - Pre-parsed functions from parseFunctionsRecord()
+ * @param {string} localText - Optional text of current record for local function definitions
+ * @param {Array} allTokens - Optional pre-tokenized tokens for localText
+ * @returns {EvalContext} Configured evaluation context
+ */
+function createEvalContext(record, parsedConstants, parsedFunctions, localText = null, allTokens = null) {
+    const context = new EvalContext();
+    context.degreesMode = (record && record.degreesMode) || false;
+    context.places = (record && record.places != null) ? record.places : 4;
+
+    // Overlay the compiled constants and user functions (callers provide
+    // pre-parsed results from getReferenceInfo; compiled once per pair)
+    const reference = compileReferenceContext(parsedConstants, parsedFunctions);
+    context.constants = reference.constants;
+    context.constantComments = reference.constantComments;
+    context.userFunctions = reference.userFunctions;
+    const functionErrors = [...reference.functionErrors];
+
     // Also load functions defined in the current record (can't override builtins or reference functions)
     // These are local functions, not from the Functions record, so don't track them
     if (localText) {
@@ -965,6 +1067,10 @@ function createEvalContext(record, parsedConstants, parsedFunctions, localText =
             for (let l = startLine; l <= endLine; l++) fnDefLines.add(l);
             try {
                 const bodyAST = parseExpression(bodyText);
+                // Copy-on-write: the compiled map is shared across records
+                if (context.userFunctions === reference.userFunctions) {
+                    context.userFunctions = new Map(reference.userFunctions);
+                }
                 // Pass null for sourceText to indicate local function (shouldn't be shown in references)
                 context.setUserFunction(name, params, bodyAST, null);
             } catch (e) {
@@ -989,7 +1095,7 @@ function createEvalContext(record, parsedConstants, parsedFunctions, localText =
  * Lines are 1-based (matching token line numbers).
  */
 function findTableDefinitions(text, allTokens) {
-    if (!allTokens) allTokens = new Tokenizer(text).tokenize();
+    if (!allTokens) allTokens = tokenize(text);
     const tables = [];
     const lineOffsets = computeLineOffsets(text);
 
@@ -1108,7 +1214,7 @@ function findTableDefinitions(text, allTokens) {
 function expandInlineExprs(text, context, record) {
     return text.replace(/\\([^\\]+)\\/g, (match, expr) => {
         try {
-            const tokens = getLineTokens(new Tokenizer(expr).tokenize(), 0);
+            const tokens = getLineTokens(tokenize(expr), 0);
             const fmt = getInlineEvalFormat(tokens, record || {});
             // Strip the format suffix (as measured by getInlineEvalFormat)
             // before parsing the expression
@@ -1134,7 +1240,7 @@ if (typeof module !== 'undefined' && module.exports) {
         buildOutputLine, capturePreSolveValues, clearVariables,
         findExpressionOutputs, findEquationsAndOutputs,
         expandInlineExprs,
-        parseConstantsRecord, parseFunctionsRecord, createEvalContext,
+        parseConstantsRecord, parseFunctionsRecord, compileReferenceContext, createEvalContext,
         extractEquationFromLine, findTableDefinitions
     };
 }
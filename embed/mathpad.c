@@ -0,0 +1,364 @@
+/* mathpad.c: C interface to the MathPad solve engine (see mathpad.h).
+ *
+ * A context owns one engine process, started with posix_spawn on one end
+ * of a socket pair, and speaks the length-prefixed protocol described in
+ * solve-server.js. Nothing is shared between contexts; the socket is
+ * close-on-exec so one context's descriptors never leak into another
+ * context's engine started from a different thread.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mathpad.h"
+
+#ifndef MATHPAD_SERVER_PATH
+#define MATHPAD_SERVER_PATH "embed/solve-server.js"
+#endif
+
+/* How long mp_free waits for the engine to exit after closing its input,
+   and again after SIGTERM, before killing it */
+#ifndef MATHPAD_EXIT_GRACE_MS
+#define MATHPAD_EXIT_GRACE_MS 1000
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 /* SO_NOSIGPIPE is set on the socket instead */
+#endif
+
+extern char **environ;
+
+struct mp_context {
+    int fd;
+    pid_t pid;
+    int broken;             /* Engine failed; every call returns MP_IO */
+
+    char *req;              /* Request being built */
+    size_t req_len, req_cap;
+
+    char *buf;              /* Last reply; fields are NUL-terminated in place */
+    size_t buf_len, buf_cap;
+    size_t *fields;         /* Offset of each reply field in buf */
+    size_t field_count, field_cap;
+
+    /* Reply layout after a solve (field indexes) */
+    int solved;
+    size_t error_first, error_count, var_first, var_count;
+
+    char message[256];
+};
+
+static void set_message(mp_context *ctx, const char *fmt, const char *detail) {
+    snprintf(ctx->message, sizeof ctx->message, fmt, detail);
+}
+
+static const char *field(const mp_context *ctx, size_t index) {
+    return ctx->buf + ctx->fields[index];
+}
+
+static int grow(void *ptr, size_t *cap, size_t need, size_t size) {
+    size_t n = *cap ? *cap : 64;
+    void *p;
+    if (need <= *cap) return 1;
+    while (n < need) n *= 2;
+    p = realloc(*(void **)ptr, n * size);
+    if (!p) return 0;
+    *(void **)ptr = p;
+    *cap = n;
+    return 1;
+}
+
+/* Append bytes to the request */
+static int put(mp_context *ctx, const char *data, size_t len) {
+    if (!grow(&ctx->req, &ctx->req_cap, ctx->req_len + len, 1)) return 0;
+    memcpy(ctx->req + ctx->req_len, data, len);
+    ctx->req_len += len;
+    return 1;
+}
+
+static int put_field(mp_context *ctx, const char *text) {
+    char len[32];
+    size_t n = text ? strlen(text) : 0;
+    int k = snprintf(len, sizeof len, "%lu\n", (unsigned long)n);
+    return put(ctx, len, (size_t)k) && put(ctx, text ? text : "", n) && put(ctx, "\n", 1);
+}
+
+static int begin(mp_context *ctx, const char *word, size_t count) {
+    char header[64];
+    int k = snprintf(header, sizeof header, "%s %lu\n", word, (unsigned long)count);
+    ctx->req_len = 0;
+    return put(ctx, header, (size_t)k);
+}
+
+/* Read until buf holds at least need bytes */
+static int fill(mp_context *ctx, size_t need) {
+    while (ctx->buf_len < need) {
+        ssize_t n;
+        if (!grow(&ctx->buf, &ctx->buf_cap, need < 4096 ? 4096 : need, 1)) return 0;
+        n = recv(ctx->fd, ctx->buf + ctx->buf_len, ctx->buf_cap - ctx->buf_len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        ctx->buf_len += (size_t)n;
+    }
+    return 1;
+}
+
+/* Read a line starting at *pos; returns its number value, or -1 */
+static long read_number_line(mp_context *ctx, size_t *pos, char *word, size_t word_size) {
+    size_t start = *pos, end = start;
+    for (;;) {
+        if (end >= ctx->buf_len && !fill(ctx, end + 1)) return -1;
+        if (ctx->buf[end] == '\n') break;
+        end++;
+    }
+    ctx->buf[end] = '\0';
+    *pos = end + 1;
+    if (word) {
+        /* Header line: WORD COUNT */
+        char *space = strchr(ctx->buf + start, ' ');
+        if (!space || (size_t)(space - (ctx->buf + start)) >= word_size) return -1;
+        memcpy(word, ctx->buf + start, (size_t)(space - (ctx->buf + start)));
+        word[space - (ctx->buf + start)] = '\0';
+        start = (size_t)(space + 1 - ctx->buf);
+    }
+    return strtol(ctx->buf + start, NULL, 10);
+}
+
+/* Send the request and read the reply into buf/fields. Returns MP_OK for
+   an ok reply, MP_INVALID for an error reply, MP_IO if the engine failed. */
+static mp_status exchange(mp_context *ctx) {
+    char word[16];
+    size_t sent = 0, pos = 0, i;
+    long count;
+
+    if (ctx->broken) return MP_IO;
+    errno = 0;
+    while (sent < ctx->req_len) {
+        ssize_t n = send(ctx->fd, ctx->req + sent, ctx->req_len - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) goto failed;
+        sent += (size_t)n;
+    }
+
+    ctx->buf_len = 0;
+    ctx->field_count = 0;
+    count = read_number_line(ctx, &pos, word, sizeof word);
+    if (count < 0) goto failed;
+    if (!grow(&ctx->fields, &ctx->field_cap, (size_t)count, sizeof *ctx->fields)) goto failed;
+    for (i = 0; i < (size_t)count; i++) {
+        long len = read_number_line(ctx, &pos, NULL, 0);
+        if (len < 0 || !fill(ctx, pos + (size_t)len + 1)) goto failed;
+        ctx->fields[i] = pos;
+        pos += (size_t)len;
+        ctx->buf[pos++] = '\0'; /* Over the field's trailing newline */
+    }
+    ctx->field_count = (size_t)count;
+
+    if (strcmp(word, "ok") == 0) return MP_OK;
+    set_message(ctx, "%s", count > 0 ? field(ctx, 0) : "engine error");
+    return MP_INVALID;
+
+failed:
+    ctx->broken = 1;
+    ctx->field_count = 0;
+    set_message(ctx, "engine process failed: %s", errno ? strerror(errno) : "connection closed");
+    return MP_IO;
+}
+
+static void reset_results(mp_context *ctx) {
+    ctx->solved = 0;
+    ctx->error_count = ctx->var_count = 0;
+}
+
+mp_context *mp_create(const char *constants_text, const char *functions_text) {
+    const char *node = getenv("MATHPAD_NODE");
+    const char *server = getenv("MATHPAD_SERVER");
+    char *argv[3];
+    int sv[2];
+    posix_spawn_file_actions_t actions;
+    mp_context *ctx = calloc(1, sizeof *ctx);
+
+    if (!ctx) return NULL;
+    ctx->fd = -1;
+    argv[0] = (char *)(node && *node ? node : "node");
+    argv[1] = (char *)(server && *server ? server : MATHPAD_SERVER_PATH);
+    argv[2] = NULL;
+
+#ifdef SOCK_CLOEXEC
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) goto failed;
+#else
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) goto failed;
+    fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+    fcntl(sv[1], F_SETFD, FD_CLOEXEC);
+#endif
+#ifdef SO_NOSIGPIPE
+    {
+        int on = 1;
+        setsockopt(sv[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof on);
+    }
+#endif
+    ctx->fd = sv[0];
+
+    /* dup2 clears close-on-exec on the engine's stdin and stdout */
+    if (posix_spawn_file_actions_init(&actions) != 0) {
+        close(sv[1]);
+        goto failed;
+    }
+    posix_spawn_file_actions_adddup2(&actions, sv[1], 0);
+    posix_spawn_file_actions_adddup2(&actions, sv[1], 1);
+    if (posix_spawnp(&ctx->pid, argv[0], &actions, NULL, argv, environ) != 0) ctx->pid = 0;
+    posix_spawn_file_actions_destroy(&actions);
+    close(sv[1]);
+    if (ctx->pid == 0) goto failed;
+
+    if (!begin(ctx, "references", 2) || !put_field(ctx, constants_text) || !put_field(ctx, functions_text)) {
+        goto failed;
+    }
+    if (exchange(ctx) != MP_OK) goto failed;
+    return ctx;
+
+failed:
+    mp_free(ctx);
+    return NULL;
+}
+
+/* Reap the engine if it exits within ms milliseconds; returns 1 once it's gone */
+static int reap(pid_t pid, long ms) {
+    struct timespec tick = {0, 10 * 1000000L};
+    for (;;) {
+        pid_t r = waitpid(pid, NULL, WNOHANG);
+        if (r == pid || (r < 0 && errno != EINTR)) return 1;
+        if (ms <= 0) return 0;
+        nanosleep(&tick, NULL);
+        ms -= 10;
+    }
+}
+
+void mp_free(mp_context *ctx) {
+    if (!ctx) return;
+    /* The engine exits at end of input, once any solve in progress is done.
+       One that doesn't (stuck, or a long solve with no time limit) gets
+       SIGTERM and then SIGKILL, so mp_free never blocks for long. */
+    if (ctx->fd >= 0) close(ctx->fd);
+    if (ctx->pid > 0 && !reap(ctx->pid, MATHPAD_EXIT_GRACE_MS)) {
+        kill(ctx->pid, SIGTERM);
+        if (!reap(ctx->pid, MATHPAD_EXIT_GRACE_MS)) {
+            kill(ctx->pid, SIGKILL);
+            while (waitpid(ctx->pid, NULL, 0) < 0 && errno == EINTR) {
+            }
+        }
+    }
+    free(ctx->req);
+    free(ctx->buf);
+    free(ctx->fields);
+    free(ctx);
+}
+
+mp_status mp_load_record(mp_context *ctx, const char *record_text) {
+    reset_results(ctx);
+    if (!begin(ctx, "record", 1) || !put_field(ctx, record_text)) {
+        set_message(ctx, "%s", "out of memory");
+        return MP_INVALID;
+    }
+    return exchange(ctx);
+}
+
+mp_status mp_solve(mp_context *ctx, const char *const *names, const char *const *values,
+                   size_t count, double timeout_ms) {
+    char timeout[32];
+    size_t i;
+    mp_status status;
+    const char *result;
+
+    reset_results(ctx);
+    snprintf(timeout, sizeof timeout, "%.17g", timeout_ms > 0 ? timeout_ms : 0.0);
+    if (!begin(ctx, "solve", 1 + 2 * count) || !put_field(ctx, timeout)) goto no_memory;
+    for (i = 0; i < count; i++) {
+        if (!names[i]) {
+            set_message(ctx, "%s", "input name is NULL");
+            return MP_INVALID;
+        }
+        if (!put_field(ctx, names[i]) || !put_field(ctx, values[i])) goto no_memory;
+    }
+
+    status = exchange(ctx);
+    if (status != MP_OK) return status;
+    if (ctx->field_count < 3) {
+        set_message(ctx, "%s", "malformed solve reply");
+        return MP_INVALID;
+    }
+    ctx->error_first = 3;
+    ctx->error_count = (size_t)strtoul(field(ctx, 2), NULL, 10);
+    if (ctx->error_first + ctx->error_count > ctx->field_count) {
+        ctx->error_count = 0;
+        set_message(ctx, "%s", "malformed solve reply");
+        return MP_INVALID;
+    }
+    ctx->var_first = ctx->error_first + ctx->error_count;
+    ctx->var_count = (ctx->field_count - ctx->var_first) / 2;
+    ctx->solved = 1;
+
+    result = field(ctx, 0);
+    if (strcmp(result, "timeout") == 0) return MP_TIMEOUT;
+    return strcmp(result, "ok") == 0 ? MP_OK : MP_SOLVE_ERRORS;
+
+no_memory:
+    set_message(ctx, "%s", "out of memory");
+    return MP_INVALID;
+}
+
+const char *mp_output(const mp_context *ctx) {
+    return ctx->solved ? field(ctx, 1) : "";
+}
+
+size_t mp_error_count(const mp_context *ctx) {
+    return ctx->error_count;
+}
+
+const char *mp_error(const mp_context *ctx, size_t index) {
+    return index < ctx->error_count ? field(ctx, ctx->error_first + index) : NULL;
+}
+
+size_t mp_variable_count(const mp_context *ctx) {
+    return ctx->var_count;
+}
+
+const char *mp_variable_name(const mp_context *ctx, size_t index) {
+    return index < ctx->var_count ? field(ctx, ctx->var_first + 2 * index) : NULL;
+}
+
+const char *mp_get_text(const mp_context *ctx, const char *name) {
+    size_t i;
+    for (i = 0; i < ctx->var_count; i++) {
+        if (strcmp(field(ctx, ctx->var_first + 2 * i), name) == 0) {
+            return field(ctx, ctx->var_first + 2 * i + 1);
+        }
+    }
+    return NULL;
+}
+
+mp_status mp_get_number(const mp_context *ctx, const char *name, double *value) {
+    const char *text = mp_get_text(ctx, name);
+    char *end;
+    double v;
+    if (!text || !*text) return MP_NOT_FOUND;
+    v = strtod(text, &end);
+    if (*end != '\0') return MP_NOT_FOUND; /* Not a single number */
+    *value = v;
+    return MP_OK;
+}
+
+const char *mp_message(const mp_context *ctx) {
+    return ctx->message;
+}
@@ -0,0 +1,90 @@
+/* mathpad.h: C interface to the MathPad solve engine.
+ *
+ * NOTE: this is not a native engine. Every context spawns its own Node.js
+ * process running embed/solve-server.js, so Node must be installed where
+ * the library runs, and each context costs a process (roughly 60 MB
+ * resident and around 150 ms to start). Create contexts once and reuse them;
+ * don't create one per solve.
+ *
+ * Each context talks to its engine over a socket, so contexts share no
+ * state: any number of threads may each use their own context at the same
+ * time. A single context must not be used by two threads at once.
+ *
+ * Strings returned by a context stay valid until the next call that
+ * changes it (mp_load_record, mp_solve) or mp_free. Replies are read into
+ * one buffer per context that is reused from call to call, so a context
+ * that keeps solving the same record doesn't allocate once warmed up.
+ *
+ * The engine is found through two environment variables, read by
+ * mp_create: MATHPAD_NODE (the node executable, default "node" on the
+ * PATH) and MATHPAD_SERVER (default MATHPAD_SERVER_PATH, set at build
+ * time). Build the shared library with e.g.
+ *
+ *   cc -std=c99 -O2 -fPIC -shared -o libmathpad.so embed/mathpad.c \
+ *      -DMATHPAD_SERVER_PATH='"/opt/mathpad/embed/solve-server.js"'
+ */
+#ifndef MATHPAD_H
+#define MATHPAD_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mp_context mp_context;
+
+typedef enum {
+    MP_OK = 0,          /* Success; for mp_solve, solved without errors */
+    MP_SOLVE_ERRORS,    /* Solve finished but reported errors (mp_error) */
+    MP_TIMEOUT,         /* Solve ran out of time; results are partial */
+    MP_NOT_FOUND,       /* No such variable, or it has no numeric value */
+    MP_INVALID,         /* Request rejected; see mp_message */
+    MP_IO               /* Engine process failed; the context is unusable */
+} mp_status;
+
+/* Start an engine with the text of the Constants and Functions reference
+   records (either may be NULL). Returns NULL if it can't be started. */
+mp_context *mp_create(const char *constants_text, const char *functions_text);
+
+/* Stop the engine and free the context. NULL is ignored. An engine still
+   busy after a grace period (MATHPAD_EXIT_GRACE_MS, 1 s) is killed. */
+void mp_free(mp_context *ctx);
+
+/* Load the record to solve, as it appears in a MathPad export file:
+   optional settings lines (e.g. Places = 2; StripZeros = 1) followed by
+   the record text. */
+mp_status mp_load_record(mp_context *ctx, const char *record_text);
+
+/* Solve the loaded record with the named input variables set to the given
+   values (MathPad text, e.g. "6.5%"; "" clears an input so it is solved
+   for). count may be 0. timeout_ms <= 0 means no time limit. */
+mp_status mp_solve(mp_context *ctx, const char *const *names, const char *const *values,
+                   size_t count, double timeout_ms);
+
+/* Solved record text, formatted as the editor shows it ("" before a solve) */
+const char *mp_output(const mp_context *ctx);
+
+/* Errors reported by the last solve */
+size_t mp_error_count(const mp_context *ctx);
+const char *mp_error(const mp_context *ctx, size_t index);
+
+/* Variables declared in the record, with their values after the last solve */
+size_t mp_variable_count(const mp_context *ctx);
+const char *mp_variable_name(const mp_context *ctx, size_t index);
+
+/* Value of a variable as full-precision text ("" when unsolved), or NULL
+   if the record doesn't declare it */
+const char *mp_get_text(const mp_context *ctx, const char *name);
+
+/* Numeric value of a variable */
+mp_status mp_get_number(const mp_context *ctx, const char *name, double *value);
+
+/* Message for the last MP_INVALID or MP_IO status ("" if none) */
+const char *mp_message(const mp_context *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MATHPAD_H */
@@ -0,0 +1,155 @@
+#!/usr/bin/env node
+/**
+ * MathPad Solve Server
+ *
+ * Runs the solve engine for the C library in embed/mathpad.c: each
+ * mp_context starts one server process and talks to it over its stdin and
+ * stdout. The server holds one record and its reference records and
+ * answers one request at a time.
+ *
+ * Messages (both directions) are a line `WORD COUNT` followed by COUNT
+ * fields, each a line with its length in bytes, the UTF-8 bytes and a
+ * newline, so text needs no escaping:
+ *
+ *   references CONSTANTS FUNCTIONS   Reference record texts ('' for none)
+ *   record TEXT                      Record to solve, as in an export file:
+ *                                    optional settings lines (Places = 4;
+ *                                    ...) then the record text
+ *   solve TIMEOUT_MS [NAME VALUE]... Solve with the named inputs set to the
+ *                                    values ('' clears an input)
+ *
+ * Replies are `ok` with the request's results or `error MESSAGE`. A solve
+ * replies with STATUS (ok, error or timeout), the solved text, the error
+ * count, the errors, then NAME VALUE for every declared variable (values
+ * at full precision, '' when unsolved).
+ *
+ * Each set of input names gets its own prepared record (prepareRecord), so
+ * repeated solves of a record replay its solve plans.
+ */
+
+const path = require('path');
+
+// Path to docs/js modules
+const jsPath = path.join(__dirname, '..', 'docs', 'js');
+
+function loadModules() {
+    for (const name of ['parser', 'line-parser', 'evaluator', 'solver', 'variables', 'storage', 'solve-engine']) {
+        Object.assign(global, require(path.join(jsPath, name + '.js')));
+    }
+}
+
+// stdout carries the protocol; keep any logging off it
+console.log = console.error;
+
+let parsedConstants = null;
+let parsedFunctions = null;
+let record = null;      // { text, settings } of the loaded record
+let prepared = null;    // input names joined by '\n' → prepareRecord result
+
+function formatValue(value) {
+    if (value === undefined || value === null) return '';
+    return Array.isArray(value) ? value.join(' ') : String(value);
+}
+
+const handlers = {
+    references([constantsText, functionsText]) {
+        parsedConstants = constantsText ? parseConstantsRecord(constantsText) : null;
+        parsedFunctions = functionsText ? parseFunctionsRecord(functionsText) : null;
+        prepared = new Map();
+        return [];
+    },
+
+    record([text]) {
+        const imported = importFromText(text || '').records[0];
+        if (!imported) throw new Error('Record is empty');
+        record = { text: imported.text, settings: imported };
+        prepared = new Map();
+        return [];
+    },
+
+    solve([timeoutMs, ...pairs]) {
+        if (!record) throw new Error('No record loaded');
+        if (pairs.length % 2 !== 0) throw new Error('solve takes NAME VALUE pairs');
+        const names = pairs.filter((_, i) => i % 2 === 0);
+        const values = pairs.filter((_, i) => i % 2 === 1);
+        const key = names.join('\n');
+        let entry = prepared.get(key);
+        if (!entry) {
+            entry = prepareRecord(record.text, record.settings, parsedConstants, parsedFunctions, names);
+            prepared.set(key, entry);
+        }
+        const timeout = parseFloat(timeoutMs);
+        const r = solvePrepared(entry, values, timeout > 0 ? timeout : Infinity);
+        const status = r.timedOut ? 'timeout' : r.errors.length > 0 ? 'error' : 'ok';
+        const variables = [];
+        entry.inputs.forEach((input, i) => variables.push(input.name, formatValue(r.inputValues[i])));
+        entry.outputNames.forEach((name, i) => variables.push(name, formatValue(r.values[i])));
+        return [status, r.text, String(r.errors.length), ...r.errors, ...variables];
+    }
+};
+
+function encode(word, fields) {
+    const parts = [Buffer.from(`${word} ${fields.length}\n`)];
+    for (const field of fields) {
+        const bytes = Buffer.from(field, 'utf8');
+        parts.push(Buffer.from(`${bytes.length}\n`), bytes, Buffer.from('\n'));
+    }
+    return Buffer.concat(parts);
+}
+
+/**
+ * Take one complete message off the front of the input buffer; returns
+ * { word, fields, rest } or null until the whole message has arrived
+ */
+function decode(buf) {
+    let pos = 0;
+    const line = () => {
+        const end = buf.indexOf(10, pos);
+        if (end < 0) return null;
+        const s = buf.toString('utf8', pos, end);
+        pos = end + 1;
+        return s;
+    };
+    const header = line();
+    if (header === null) return null;
+    const m = header.match(/^(\w+) (\d+)$/);
+    if (!m) throw new Error(`Bad message header: ${header.slice(0, 40)}`);
+    const fields = [];
+    for (let i = 0; i < parseInt(m[2], 10); i++) {
+        const len = line();
+        if (len === null) return null;
+        const n = parseInt(len, 10);
+        if (buf.length < pos + n + 1) return null;
+        fields.push(buf.toString('utf8', pos, pos + n));
+        pos += n + 1;
+    }
+    return { word: m[1], fields, rest: buf.subarray(pos) };
+}
+
+function respond(word, fields) {
+    try {
+        const handler = Object.prototype.hasOwnProperty.call(handlers, word) ? handlers[word] : null;
+        if (!handler) throw new Error(`Unknown request: ${word}`);
+        return encode('ok', handler(fields));
+    } catch (e) {
+        return encode('error', [e.message]);
+    }
+}
+
+loadModules();
+let pending = Buffer.alloc(0);
+process.stdin.on('data', chunk => {
+    pending = pending.length > 0 ? Buffer.concat([pending, chunk]) : chunk;
+    let msg;
+    try {
+        while ((msg = decode(pending)) !== null) {
+            pending = msg.rest;
+            process.stdout.write(respond(msg.word, msg.fields));
+        }
+    } catch (e) {
+        // Framing is lost; the client treats the closed stream as an I/O error
+        console.error('solve-server:', e.message);
+        process.exit(1);
+    }
+});
+process.stdin.on('end', () => process.exit(0));
@@ -0,0 +1,107 @@
+/* embed-smoke.c: smoke test of the C interface in embed/ (mathpad.h).
+ *
+ * Built and run by tests/run-embed-tests.js. Prints PASS/FAIL per check
+ * and exits non-zero if any failed. argv[1], when given, is an engine
+ * that never exits on its own, used to check that mp_free kills it.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mathpad.h"
+
+static int failed = 0;
+
+static void check(const char *name, int ok, const char *detail) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", name);
+    if (!ok) {
+        printf("  %s\n", detail ? detail : "");
+        failed++;
+    }
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static const char *loan =
+    "Places = 2; StripZeros = 1\n"
+    "\"Loan payment\"\n"
+    "pmt = -(pv + fv / (1 + mint)**n) * mint / (1 - (1 + mint)**-n)\n"
+    "pmt$: \"monthly payment\"\n"
+    "pv$: $100,000\n"
+    "fv$: 0\n"
+    "yint%: 6%\n"
+    "n: 360\n"
+    "mint = yint / 12\n"
+    "circle: 2*pi\n";
+
+int main(int argc, char **argv) {
+    const char *names[] = {"pv", "pmt"};
+    const char *values[2];
+    double pmt = 0, pv = 0, circle = 0;
+    mp_status s;
+    mp_context *ctx = mp_create("pi: 3.14159265358979", NULL);
+
+    check("create", ctx != NULL, "mp_create returned NULL (is node on the PATH?)");
+    if (!ctx) return 1;
+
+    s = mp_load_record(ctx, loan);
+    check("load record", s == MP_OK, mp_message(ctx));
+
+    /* Solve for the payment, then back for the loan amount */
+    values[0] = "100000";
+    values[1] = "";
+    s = mp_solve(ctx, names, values, 2, 5000);
+    check("solve payment", s == MP_OK && mp_get_number(ctx, "pmt", &pmt) == MP_OK &&
+          fabs(pmt + 599.55) < 0.01, mp_output(ctx));
+    check("constant from references", mp_get_number(ctx, "circle", &circle) == MP_OK &&
+          fabs(circle - 6.2831853) < 1e-6, mp_get_text(ctx, "circle"));
+    check("variables listed", mp_variable_count(ctx) >= 6 &&
+          strcmp(mp_variable_name(ctx, 0), "pv") == 0, mp_variable_name(ctx, 0));
+
+    values[0] = "";
+    values[1] = "-599.55";
+    s = mp_solve(ctx, names, values, 2, 5000);
+    check("solve loan amount", s == MP_OK && mp_get_number(ctx, "pv", &pv) == MP_OK &&
+          fabs(pv - 100000) < 1, mp_output(ctx));
+
+    /* Errors */
+    values[0] = "1";
+    s = mp_solve(ctx, (const char *const[]){"nosuch"}, values, 1, 0);
+    check("unknown input rejected", s == MP_INVALID && strstr(mp_message(ctx), "nosuch"), mp_message(ctx));
+    check("missing variable", mp_get_text(ctx, "nosuch") == NULL &&
+          mp_get_number(ctx, "nosuch", &pv) == MP_NOT_FOUND, NULL);
+
+    s = mp_load_record(ctx, "a: 1\nb: 3\nb = a * 2\n");
+    check("load contradiction", s == MP_OK, mp_message(ctx));
+    s = mp_solve(ctx, NULL, NULL, 0, 0);
+    check("solve errors reported", s == MP_SOLVE_ERRORS && mp_error_count(ctx) > 0 &&
+          strstr(mp_error(ctx, 0), "balance"), mp_error_count(ctx) ? mp_error(ctx, 0) : "no errors");
+
+    check("empty record rejected", mp_load_record(ctx, "") == MP_INVALID, mp_message(ctx));
+    mp_free(ctx);
+
+    /* An engine that ignores end of input and SIGTERM is killed */
+    if (argc > 1) {
+        double start;
+        setenv("MATHPAD_SERVER", argv[1], 1);
+        ctx = mp_create(NULL, NULL);
+        check("create stuck engine", ctx != NULL, "mp_create returned NULL");
+        start = now_ms();
+        mp_free(ctx);
+        check("free kills stuck engine", now_ms() - start < 10000, "mp_free took too long");
+    }
+
+    setenv("MATHPAD_SERVER", "/nonexistent/solve-server.js", 1);
+    check("missing server", mp_create(NULL, NULL) == NULL, "mp_create succeeded");
+
+    printf("\n%s\n", failed ? "embed smoke test failed" : "embed smoke test passed");
+    return failed ? 1 : 0;
+}
@@ -18,14 +18,14 @@ const input = fs.readFileSync(path.join(__dirname, "input", testName + ".txt"),
 const data = importFromText(input);
 const constantsRecord = data.records.find(r => isReferenceRecord(r, 'Constants'));
 const functionsRecord = data.records.find(r => isReferenceRecord(r, 'Functions'));
-const constantsTokens = constantsRecord ? new Tokenizer(constantsRecord.text).tokenize() : null;
-const functionsTokens = functionsRecord ? new Tokenizer(functionsRecord.text).tokenize() : null;
+const constantsTokens = constantsRecord ? tokenize(constantsRecord.text) : null;
+const functionsTokens = functionsRecord ? tokenize(functionsRecord.text) : null;
 const parsedConstants = constantsRecord ? parseConstantsRecord(constantsRecord.text, constantsTokens) : null;
 const parsedFunctions = functionsRecord ? parseFunctionsRecord(functionsRecord.text, functionsTokens) : null;
 const traceMode = testName === 'trace-tests';
 const varStatusByRecord = [];
 for (const record of data.records) {
-    const allTokens = new Tokenizer(record.text).tokenize();
+    const allTokens = tokenize(record.text);
     const context = createEvalContext(record, parsedConstants, parsedFunctions, record.text, allTokens);
     // Tests always include the table-outputs section (production defaults
     // to off — opt-in via Shift+Solve).
@@ -33,7 +33,7 @@ for (const record of data.records) {
     record.text = result.text;
 
     // Re-solve formatted output: idempotency check, rounding detection, table evaluation
-    const verifyTokens = new Tokenizer(record.text).tokenize();
+    const verifyTokens = tokenize(record.text);
     const verifyContext = createEvalContext(record, parsedConstants, parsedFunctions, record.text, verifyTokens);
     verifyContext.preSolveValues = context.preSolveValues; // preserve x~ values so counters don't double-increment
     const verifyResult = solveRecord(record.text, verifyContext, record, verifyTokens, false, false, true);
@@ -0,0 +1,69 @@
+#!/usr/bin/env node
+/**
+ * MathPad C Interface Smoke Test
+ *
+ * Builds embed/mathpad.c with tests/embed-smoke.c using the system C
+ * compiler and runs it against embed/solve-server.js, so the C ABI and the
+ * solve-server protocol are exercised together. Skipped (exit 0) when no
+ * compiler is found.
+ *
+ * Usage: node tests/run-embed-tests.js
+ *   CC=compiler   C compiler to use (default cc)
+ */
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { spawnSync } = require('child_process');
+
+const root = path.join(__dirname, '..');
+
+// Answers the references request, then ignores end of input and SIGTERM
+const STUCK_SERVER = `
+process.on('SIGTERM', () => {});
+process.stdin.once('data', () => process.stdout.write('ok 0\\n'));
+process.stdin.on('end', () => {});
+setInterval(() => {}, 1000);
+`;
+
+function main() {
+    const cc = process.env.CC || 'cc';
+    const probe = spawnSync(cc, ['--version'], { encoding: 'utf8' });
+    if (probe.error) {
+        console.log(`SKIP: no C compiler (${cc})`);
+        return;
+    }
+
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'mathpad-embed-'));
+    try {
+        const exe = path.join(dir, 'embed-smoke');
+        const server = JSON.stringify(path.join(root, 'embed', 'solve-server.js'));
+        const build = spawnSync(cc, [
+            '-std=c99', '-Wall', '-Wextra', '-Werror', '-O2',
+            `-DMATHPAD_SERVER_PATH=${server}`, '-DMATHPAD_EXIT_GRACE_MS=200',
+            `-I${path.join(root, 'embed')}`,
+            '-o', exe, path.join(root, 'embed', 'mathpad.c'), path.join(__dirname, 'embed-smoke.c'), '-lm'
+        ], { encoding: 'utf8' });
+        if (build.status !== 0) {
+            console.log('FAIL: build');
+            console.log((build.stderr || build.error?.message || '').replace(/^/gm, '  '));
+            process.exit(1);
+        }
+
+        const stuck = path.join(dir, 'stuck-server.js');
+        fs.writeFileSync(stuck, STUCK_SERVER);
+        const env = { ...process.env, MATHPAD_NODE: process.execPath };
+        delete env.MATHPAD_SERVER;
+        const run = spawnSync(exe, [stuck], { encoding: 'utf8', env, timeout: 60000 });
+        process.stdout.write(run.stdout || '');
+        if (run.status !== 0) {
+            if (run.stderr) console.log(run.stderr.replace(/^/gm, '  '));
+            if (run.error) console.log(`  ${run.error.message}`);
+            process.exit(1);
+        }
+    } finally {
+        fs.rmSync(dir, { recursive: true, force: true });
+    }
+}
+
+main();
@@ -2,9 +2,21 @@
 /**
  * MathPad Test Harness
  *
- * Runs tests by comparing solved output against expected output.
+ * Runs tests by comparing solved output against expected output. Each test
+ * file (and each --runs repetition) starts from empty parse, substitution and
+ * root caches, so results don't depend on which files ran before.
  *
- * Usage: node tests/run-tests.js
+ * Usage: node tests/run-tests.js [options]
+ *
+ * Timing options (solve time is measured per record, both solve passes):
+ *   --timing               Print per-record solve times (median over runs) and parse/root cache hit rates
+ *   --runs N               Run each file N times for stable numbers (implies --timing)
+ *   --save-baseline [file] Write per-record timings as the JSON baseline
+ *   --baseline [file]      Compare against the baseline and flag regressions
+ *   --threshold F          Regression threshold as a fraction (default 0.25 = +25%)
+ *   --min-ms MS            Ignore regressions smaller than MS milliseconds (default 1)
+ *   --fail-on-regression   Exit non-zero when a regression is flagged
+ *   Default baseline file: tests/timing-baseline.json (machine-specific, not committed)
  *
  * Test files:
  *   tests/input/*.txt    - MathPad export files (before solving)
@@ -24,6 +36,57 @@ const { formatVarStatus, injectVarStatusLines } = require('./var-status-utils.js
 // Path to docs/js modules
 const jsPath = path.join(__dirname, '..', 'docs', 'js');
 
+const DEFAULT_BASELINE = path.join(__dirname, 'timing-baseline.json');
+
+/**
+ * Parse command-line options
+ */
+function parseArgs(argv) {
+    const opts = {
+        timing: false, runs: 1, saveBaseline: null, baseline: null,
+        threshold: 0.25, minMs: 1, failOnRegression: false
+    };
+    // Optional file argument: the next token, unless it's another flag
+    const fileArg = (i) => (argv[i + 1] && !argv[i + 1].startsWith('--')) ? argv[i + 1] : null;
+    for (let i = 0; i < argv.length; i++) {
+        switch (argv[i]) {
+            case '--timing':
+                opts.timing = true;
+                break;
+            case '--runs':
+                opts.runs = Math.max(1, parseInt(argv[++i], 10) || 1);
+                opts.timing = true;
+                break;
+            case '--save-baseline': {
+                const f = fileArg(i);
+                if (f) i++;
+                opts.saveBaseline = f ? path.resolve(f) : DEFAULT_BASELINE;
+                opts.timing = true;
+                break;
+            }
+            case '--baseline': {
+                const f = fileArg(i);
+                if (f) i++;
+                opts.baseline = f ? path.resolve(f) : DEFAULT_BASELINE;
+                opts.timing = true;
+                break;
+            }
+            case '--threshold':
+                opts.threshold = parseFloat(argv[++i]);
+                break;
+            case '--min-ms':
+                opts.minMs = parseFloat(argv[++i]);
+                break;
+            case '--fail-on-regression':
+                opts.failOnRegression = true;
+                break;
+            default:
+                throw new Error(`Unknown option: ${argv[i]}`);
+        }
+    }
+    return opts;
+}
+
 // Load modules in dependency order, making exports global
 function loadModules() {
     // Parser (no dependencies)
@@ -36,6 +99,9 @@ function loadModules() {
     global.Parser = parser.Parser;
     global.ParseError = parser.ParseError;
     global.tokenize = parser.tokenize;
+    global.parseCacheStats = parser.parseCacheStats;
+    global.clearParseCache = parser.clearParseCache;
+    global.resetParseCacheStats = parser.resetParseCacheStats;
     global.parseExpression = parser.parseExpression;
     global.parseTokens = parser.parseTokens;
     global.findLineCommentStart = parser.findLineCommentStart;
@@ -51,6 +117,12 @@ function loadModules() {
     global.EvalContext = evaluator.EvalContext;
     global.EvalError = evaluator.EvalError;
     global.evaluate = evaluator.evaluate;
+    global.evaluateInterval = evaluator.evaluateInterval;
+    global.evaluateDual = evaluator.evaluateDual;
+    global.canEvaluateDual = evaluator.canEvaluateDual;
+    global.evaluateBatch = evaluator.evaluateBatch;
+    global.canEvaluateBatch = evaluator.canEvaluateBatch;
+    global.canEvaluateInterval = evaluator.canEvaluateInterval;
     global.formatNumber = evaluator.formatNumber;
     global.addCommaGrouping = evaluator.addCommaGrouping;
     global.formatMoney = evaluator.formatMoney;
@@ -71,12 +143,19 @@ function loadModules() {
     // Solver (depends on parser, evaluator)
     const solver = require(path.join(jsPath, 'solver.js'));
     global.SolverError = solver.SolverError;
+    global.SolveTimeoutError = solver.SolveTimeoutError;
+    global.SolveCancelToken = solver.SolveCancelToken;
     global.brent = solver.brent;
     global.solveEquation = solver.solveEquation;
+    global.solveLinearSystem = solver.solveLinearSystem;
+    global.newtonSystem = solver.newtonSystem;
     global.findVariablesInAST = solver.findVariablesInAST;
     global.isDefinitionEquation = solver.isDefinitionEquation;
     global.buildSubstitutionMap = solver.buildSubstitutionMap;
     global.substituteInAST = solver.substituteInAST;
+    global.specializeForUnknown = solver.specializeForUnknown;
+    global.astKey = solver.astKey;
+    global.clearSubstitutionCache = solver.clearSubstitutionCache;
 
     // Variables (depends on parser, evaluator)
     const variables = require(path.join(jsPath, 'variables.js'));
@@ -87,6 +166,7 @@ function loadModules() {
     global.parseAllVariables = variables.parseAllVariables;
     global.capturePreSolveValues = variables.capturePreSolveValues;
     global.clearVariables = variables.clearVariables;
+    global.compileReferenceContext = variables.compileReferenceContext;
     global.createEvalContext = variables.createEvalContext;
     global.parseConstantsRecord = variables.parseConstantsRecord;
     global.parseFunctionsRecord = variables.parseFunctionsRecord;
@@ -112,6 +192,8 @@ function loadModules() {
     // Solve Engine (depends on all above)
     const solveEngine = require(path.join(jsPath, 'solve-engine.js'));
     global.solveRecord = solveEngine.solveRecord;
+    global.rootCacheStats = solveEngine.rootCacheStats;
+    global.clearRootCache = solveEngine.clearRootCache;
     global.solveEquations = solveEngine.solveEquations;
     global.formatOutput = solveEngine.formatOutput;
     global.appendTraceSection = solveEngine.appendTraceSection;
@@ -170,22 +252,26 @@ function compareOutput(actual, expected) {
 
 /**
  * Solve all records in a data object
+ * When `timings` is an array, the solve time of each record (both passes,
+ * in ms) is pushed onto it as { index, title, ms }.
  */
-function solveAllRecords(data, traceMode = false) {
+function solveAllRecords(data, traceMode = false, timings = null) {
     const records = data.records;
 
     // Pre-parse Constants and Functions records once (matches UI flow via getReferenceInfo)
     const constantsRecord = records.find(r => isReferenceRecord(r, 'Constants'));
     const functionsRecord = records.find(r => isReferenceRecord(r, 'Functions'));
-    const constantsTokens = constantsRecord ? new Tokenizer(constantsRecord.text).tokenize() : null;
-    const functionsTokens = functionsRecord ? new Tokenizer(functionsRecord.text).tokenize() : null;
+    const constantsTokens = constantsRecord ? tokenize(constantsRecord.text) : null;
+    const functionsTokens = functionsRecord ? tokenize(functionsRecord.text) : null;
     const parsedConstants = constantsRecord ? parseConstantsRecord(constantsRecord.text, constantsTokens) : null;
     const parsedFunctions = functionsRecord ? parseFunctionsRecord(functionsRecord.text, functionsTokens) : null;
 
     const varStatusByRecord = [];
-    for (const record of records) {
+    for (const [index, record] of records.entries()) {
+        const startTime = process.hrtime.bigint();
+
         // Tokenize record text once, pass through to all consumers
-        const allTokens = new Tokenizer(record.text).tokenize();
+        const allTokens = tokenize(record.text);
 
         // Create eval context with constants and functions
         const context = createEvalContext(record, parsedConstants, parsedFunctions, record.text, allTokens);
@@ -200,7 +286,7 @@ function solveAllRecords(data, traceMode = false) {
         record.text = result.text;
 
         // Re-solve formatted output: idempotency check, rounding detection, table evaluation
-        const verifyTokens = new Tokenizer(record.text).tokenize();
+        const verifyTokens = tokenize(record.text);
         const verifyContext = createEvalContext(record, parsedConstants, parsedFunctions, record.text, verifyTokens);
         verifyContext.preSolveValues = context.preSolveValues; // preserve x~ values so counters don't double-increment
         const verifyResult = solveRecord(record.text, verifyContext, record, verifyTokens, false, false, true);
@@ -210,6 +296,10 @@ function solveAllRecords(data, traceMode = false) {
             record.text = appendTraceSection(record.text, result.trace);
         }
         let errors = verifyResult.errors;
+        if (timings) {
+            const ms = Number(process.hrtime.bigint() - startTime) / 1e6;
+            timings.push({ index, title: (record.title || '').trim(), ms });
+        }
 
         // Store any errors in the record (match UI behavior)
         if (errors && errors.length > 0) {
@@ -230,10 +320,44 @@ function solveAllRecords(data, traceMode = false) {
     return { data, varStatusByRecord };
 }
 
+// Line-boundary cases the per-line tokenize() must hand to the whole-text
+// Tokenizer: name#digits after an operator, ( ; or , on an earlier line is a
+// base literal, and quotes can open a comment spanning lines
+const TOKENIZE_CASES = [
+    'a = (\ny#16: 5',
+    'x = 3 +\n\nff#16: 1',
+    'a;\nb#2: 1',
+    'f(1,\nc#8 -> 2',
+    'x \\\ny#16: 2',
+    '"open\ncomment" y#16: 1\nz#8: 2'
+];
+
+/**
+ * Check that tokenize() (per line, cached) gives exactly the tokens of a
+ * whole-text Tokenizer for every record of the given test files.
+ */
+function runTokenizeTest(files) {
+    const texts = [...TOKENIZE_CASES];
+    for (const file of files) {
+        for (const record of importFromText(fs.readFileSync(file, 'utf8')).records) texts.push(record.text);
+    }
+    for (const text of texts) {
+        const actual = JSON.stringify(tokenize(text));
+        const expected = JSON.stringify(new Tokenizer(text).tokenize());
+        if (actual !== expected) {
+            return {
+                name: 'tokenize', passed: false,
+                error: `tokenize() differs from Tokenizer for:\n${text.split('\n').slice(0, 6).join('\n')}`
+            };
+        }
+    }
+    return { name: 'tokenize', passed: true };
+}
+
 /**
  * Run a single test
  */
-function runTest(inputPath, expectedPath) {
+function runTest(inputPath, expectedPath, timings = null) {
     const testName = path.basename(inputPath, '.txt');
 
     // Read input file
@@ -264,7 +388,7 @@ function runTest(inputPath, expectedPath) {
     const traceMode = testName === 'trace-tests';
     let varStatusByRecord;
     try {
-        ({ data, varStatusByRecord } = solveAllRecords(data, traceMode));
+        ({ data, varStatusByRecord } = solveAllRecords(data, traceMode, timings));
     } catch (e) {
         return { name: testName, passed: false, error: `Solve failed: ${e.message}` };
     }
@@ -294,10 +418,98 @@ function runTest(inputPath, expectedPath) {
     }
 }
 
+/**
+ * Summary statistics over repeated timings of one record
+ */
+function timingStats(samples) {
+    const sorted = [...samples].sort((a, b) => a - b);
+    const n = sorted.length;
+    const mid = Math.floor(n / 2);
+    const median = n % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+    const mean = sorted.reduce((a, b) => a + b, 0) / n;
+    const stddev = Math.sqrt(sorted.reduce((a, b) => a + (b - mean) ** 2, 0) / n);
+    return { median, mean, min: sorted[0], max: sorted[n - 1], stddev, runs: n };
+}
+
+/**
+ * Collapse per-run samples into per-record stats keyed "file#index"
+ */
+function summarizeTimings(samplesByFile) {
+    const records = {};
+    for (const [file, runs] of Object.entries(samplesByFile)) {
+        const byIndex = new Map();
+        for (const run of runs) {
+            for (const t of run) {
+                if (!byIndex.has(t.index)) byIndex.set(t.index, { title: t.title, samples: [] });
+                byIndex.get(t.index).samples.push(t.ms);
+            }
+        }
+        for (const [index, { title, samples }] of byIndex) {
+            records[`${file}#${index}`] = { title, ...timingStats(samples) };
+        }
+    }
+    return records;
+}
+
+/**
+ * Empty the parse, substitution and root caches before a test file runs. Root
+ * cache counts reset with the cache, so they're added to `rootTotals` first.
+ */
+function coldCaches(rootTotals) {
+    const { hits, misses } = rootCacheStats();
+    rootTotals.hits += hits;
+    rootTotals.misses += misses;
+    clearRootCache();
+    clearSubstitutionCache();
+    clearParseCache();
+}
+
+const fmtMs = ms => ms.toFixed(ms < 10 ? 2 : 1);
+
+/**
+ * Print per-file totals and the slowest records
+ */
+function printTimings(records) {
+    const byFile = new Map();
+    for (const [key, r] of Object.entries(records)) {
+        const file = key.slice(0, key.lastIndexOf('#'));
+        byFile.set(file, (byFile.get(file) || 0) + r.median);
+    }
+    console.log('\nSolve time per file (sum of record medians, ms):');
+    const files = [...byFile].sort((a, b) => b[1] - a[1]);
+    for (const [file, ms] of files) console.log(`  ${fmtMs(ms).padStart(9)}  ${file}`);
+
+    console.log('\nSlowest records (median ms, ±stddev, runs):');
+    const slowest = Object.entries(records).sort((a, b) => b[1].median - a[1].median).slice(0, 10);
+    for (const [key, r] of slowest) {
+        console.log(`  ${fmtMs(r.median).padStart(9)}  ±${fmtMs(r.stddev).padEnd(6)} x${r.runs}  ${key} ${r.title}`);
+    }
+}
+
+/**
+ * Compare against a saved baseline. A record regresses when its median
+ * exceeds the baseline median by more than `threshold` (relative), by more
+ * than `minMs`, and by more than twice the combined run-to-run spread.
+ * Returns the list of regressions.
+ */
+function compareTimings(records, baseline, threshold, minMs) {
+    const regressions = [];
+    for (const [key, r] of Object.entries(records)) {
+        const b = baseline.records[key];
+        if (!b) continue;
+        const delta = r.median - b.median;
+        const noise = 2 * Math.sqrt(r.stddev ** 2 + (b.stddev || 0) ** 2);
+        if (delta > b.median * threshold && delta > minMs && delta > noise) {
+            regressions.push({ key, title: r.title, before: b.median, after: r.median });
+        }
+    }
+    return regressions.sort((a, b) => (b.after - b.before) - (a.after - a.before));
+}
+
 /**
  * Discover and run all tests
  */
-function runAllTests() {
+function runAllTests(opts = parseArgs([])) {
     const inputDir = path.join(__dirname, 'input');
     const expectedDir = path.join(__dirname, 'expected');
 
@@ -329,6 +541,12 @@ function runAllTests() {
     console.log(`Running ${inputFiles.length} test(s)...\n`);
 
     const results = [];
+    const samplesByFile = {};
+    const rootTotals = { hits: 0, misses: 0 };
+
+    results.push(runTokenizeTest(inputFiles.flatMap(f => [path.join(inputDir, f), path.join(expectedDir, f)])
+        .filter(f => fs.existsSync(f))));
+    resetParseCacheStats(); // the check's lookups aren't solve traffic
 
     for (const file of inputFiles) {
         const inputPath = path.join(inputDir, file);
@@ -344,7 +562,18 @@ function runAllTests() {
             continue;
         }
 
-        const result = runTest(inputPath, expectedPath);
+        // Extra runs only contribute timings; pass/fail comes from the first.
+        // Every run starts cold: a file's result can't depend on what other
+        // files (or earlier runs) left in the caches, and timed samples are
+        // alike.
+        const runs = [];
+        const run = () => {
+            coldCaches(rootTotals);
+            return runTest(inputPath, expectedPath, opts.timing ? runs[runs.push([]) - 1] : null);
+        };
+        const result = run();
+        for (let r = 1; r < opts.runs; r++) run();
+        if (opts.timing) samplesByFile[file] = runs;
         results.push(result);
     }
 
@@ -367,16 +596,51 @@ function runAllTests() {
 
     console.log(`\n${passed} passed, ${failed} failed`);
 
+    let regressed = false;
+    if (opts.timing) {
+        const records = summarizeTimings(samplesByFile);
+        printTimings(records);
+
+        const cache = parseCacheStats();
+        const pct = (r) => `${(r.hitRate * 100).toFixed(1)}% (${r.hits}/${r.hits + r.misses})`;
+        console.log(`\nParse cache hit rate: lines ${pct(cache.lines)}, expressions ${pct(cache.expressions)}`);
+        coldCaches(rootTotals);
+        const { hits, misses } = rootTotals;
+        console.log(`Root cache hit rate: ${pct({ hits, misses, hitRate: hits + misses > 0 ? hits / (hits + misses) : 0 })}`);
+
+        if (opts.baseline) {
+            if (!fs.existsSync(opts.baseline)) {
+                console.log(`\nNo timing baseline at ${opts.baseline} (create one with --save-baseline)`);
+            } else {
+                const baseline = JSON.parse(fs.readFileSync(opts.baseline, 'utf8'));
+                const regressions = compareTimings(records, baseline, opts.threshold, opts.minMs);
+                console.log(`\nTiming vs baseline (${baseline.created}, threshold +${Math.round(opts.threshold * 100)}%):`);
+                if (regressions.length === 0) console.log('  no regressions');
+                for (const r of regressions) {
+                    console.log(`  REGRESSION: ${r.key} ${r.title}: ${fmtMs(r.before)} → ${fmtMs(r.after)} ms`);
+                }
+                regressed = regressions.length > 0;
+            }
+        }
+
+        if (opts.saveBaseline) {
+            const baseline = { created: new Date().toISOString(), node: process.version, runs: opts.runs, records };
+            fs.writeFileSync(opts.saveBaseline, JSON.stringify(baseline, null, 2) + '\n');
+            console.log(`\nSaved timing baseline to ${path.relative(process.cwd(), opts.saveBaseline)}`);
+        }
+    }
+
     // Exit with error code if any tests failed
-    if (failed > 0) {
+    if (failed > 0 || (regressed && opts.failOnRegression)) {
         process.exit(1);
     }
 }
 
 // Main
 try {
+    const opts = parseArgs(process.argv.slice(2));
     loadModules();
-    runAllTests();
+    runAllTests(opts);
 } catch (e) {
     console.error('Error:', e.message);
     if (e.stack) {
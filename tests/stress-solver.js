@@ -0,0 +1,389 @@
+#!/usr/bin/env node
+/**
+ * MathPad Solver Stress Search
+ *
+ * Looks for solver performance cliffs: mutates records from tests/input
+ * (adds equations, contradictions and substitution cycles, widens limits,
+ * nests user functions) and solves each mutant under a time budget. Any
+ * mutant that exceeds the budget is minimized line by line (delta
+ * debugging) and saved to tests/perf/ as a MathPad export file.
+ *
+ * Usage:
+ *   node tests/stress-solver.js [options]
+ *     --seed N            RNG seed (default 1); runs are reproducible per seed
+ *     --iterations N      Mutants to try (default 50)
+ *     --budget MS         Solve-time budget per record, both passes (default 2000)
+ *     --mutations N       Max mutations stacked on one record (default 4)
+ *     --minimize-steps N  Max solves spent minimizing one offender (default 60)
+ *     --out DIR           Where offenders are saved (default tests/perf)
+ *   node tests/stress-solver.js --replay FILE... [--budget MS] [--profile]
+ *     Re-time every record of saved cases; exits non-zero if any exceeds
+ *     the budget. --profile prints the solve profile of slow records.
+ *     Cases saved as NAME.slow.txt are known to be slow: they are reported
+ *     but don't fail the replay (one that fits the budget is flagged so the
+ *     marker can be dropped).
+ *
+ * Each solve runs in a child process that is killed once well past the
+ * budget, since a runaway solve can't be interrupted in-process.
+ */
+
+const fs = require('fs');
+const path = require('path');
+const { spawnSync } = require('child_process');
+
+// Path to docs/js modules
+const jsPath = path.join(__dirname, '..', 'docs', 'js');
+
+function loadModules() {
+    for (const name of ['parser', 'line-parser', 'evaluator', 'solver', 'variables', 'storage', 'solve-engine']) {
+        Object.assign(global, require(path.join(jsPath, name + '.js')));
+    }
+}
+
+/**
+ * Solve every record of an export the way run-tests.js does (first pass
+ * without tables, then the verify pass). Returns elapsed ms, plus the
+ * solve profile reports of each pass when profiling.
+ */
+function solveExport(text, profile = false) {
+    const data = importFromText(text);
+    const constantsRecord = data.records.find(r => isReferenceRecord(r, 'Constants'));
+    const functionsRecord = data.records.find(r => isReferenceRecord(r, 'Functions'));
+    const parsedConstants = constantsRecord ? parseConstantsRecord(constantsRecord.text) : null;
+    const parsedFunctions = functionsRecord ? parseFunctionsRecord(functionsRecord.text) : null;
+
+    const reports = [];
+    const start = process.hrtime.bigint();
+    for (const record of data.records) {
+        if (isReferenceRecord(record, 'Constants') || isReferenceRecord(record, 'Functions')) continue;
+        const allTokens = tokenize(record.text);
+        const context = createEvalContext(record, parsedConstants, parsedFunctions, record.text, allTokens);
+        const result = solveRecord(record.text, context, record, allTokens, true, false, true, profile);
+        const verifyTokens = tokenize(result.text);
+        const verifyContext = createEvalContext(record, parsedConstants, parsedFunctions, result.text, verifyTokens);
+        verifyContext.preSolveValues = context.preSolveValues;
+        const verifyResult = solveRecord(result.text, verifyContext, record, verifyTokens, false, false, true, profile);
+        if (profile) reports.push(formatProfileReport(result.profile), formatProfileReport(verifyResult.profile));
+    }
+    return { ms: Number(process.hrtime.bigint() - start) / 1e6, reports };
+}
+
+/**
+ * Time an export in a child process. Returns { ms, timedOut, error, report }.
+ * The child is killed at 2x budget (plus startup slack); a kill counts as
+ * exceeding the budget.
+ */
+function timeInChild(text, budget, profile = false) {
+    const args = [__filename, '--solve-child'];
+    if (profile) args.push('--profile');
+    const r = spawnSync(process.execPath, args, {
+        input: text,
+        encoding: 'utf8',
+        timeout: budget * 2 + 1000,
+        maxBuffer: 16 * 1024 * 1024
+    });
+    if (r.error && r.error.code === 'ETIMEDOUT') return { ms: Infinity, timedOut: true };
+    if (r.status !== 0) return { ms: NaN, error: (r.stderr || '').trim().split('\n')[0] || `exit ${r.status}` };
+    const nl = r.stdout.indexOf('\n');
+    return { ms: parseFloat(r.stdout), report: nl >= 0 ? r.stdout.slice(nl + 1) : '' };
+}
+
+// Deterministic RNG (mulberry32) so a seed reproduces the same mutants
+function makeRng(seed) {
+    let a = seed >>> 0;
+    const next = () => {
+        a = (a + 0x6D2B79F5) >>> 0;
+        let t = a;
+        t = Math.imul(t ^ (t >>> 15), t | 1);
+        t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+        return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+    };
+    return {
+        next,
+        int: (n) => Math.floor(next() * n),
+        pick: (arr) => arr[Math.floor(next() * arr.length)]
+    };
+}
+
+/**
+ * Identifiers used as variables in a record (function names excluded)
+ */
+function recordVariables(text) {
+    const names = new Set();
+    const tokens = tokenize(text).flat(); // one token array per line
+    for (let i = 0; i < tokens.length; i++) {
+        const tok = tokens[i];
+        if (tok.type !== TokenType.IDENTIFIER) continue;
+        const next = tokens[i + 1];
+        if (next && next.type === TokenType.LPAREN) continue;
+        if (builtinFunctions[tok.value.toLowerCase()] !== undefined) continue;
+        names.add(tok.value);
+    }
+    return [...names];
+}
+
+// Lines that look like equations: a single '=' and no declaration marker
+const EQUATION_LINE = /^[^":\[\]]*[^<>=!:]=[^=>][^":]*$/;
+const LIMITS = /\[([^\]:]+):([^\]:]+)(?::([^\]]+))?\]/;
+const DECLARATION = /^(\s*)([A-Za-z_]\w*)(\s*)(::|:|->>|->|<-)/;
+
+/**
+ * Mutations. Each takes (lines, vars, rng, tag) and edits `lines` in place,
+ * returning a short description (or null when it doesn't apply).
+ */
+const MUTATIONS = {
+    addEquation(lines, vars, rng) {
+        if (vars.length < 2) return null;
+        const [a, b, c] = [rng.pick(vars), rng.pick(vars), rng.pick(vars)];
+        const op = rng.pick(['+', '-', '*', '/', '**']);
+        const line = `${a} = ${b} ${op} ${c} ${rng.pick(['+', '*'])} ${1 + rng.int(9)}`;
+        lines.push(line);
+        return `add "${line}"`;
+    },
+
+    contradiction(lines, vars, rng) {
+        const eqs = lines.map((l, i) => i).filter(i => i > 0 && EQUATION_LINE.test(lines[i]));
+        if (eqs.length === 0) return null;
+        const i = rng.pick(eqs);
+        const line = `${lines[i].replace(/\/\/.*$/, '').trimEnd()} + ${1 + rng.int(5)}`;
+        lines.push(line);
+        return `contradict line ${i + 1}`;
+    },
+
+    substitutionCycle(lines, vars, rng, tag) {
+        const n = 3 + rng.int(5);
+        const names = Array.from({ length: n }, (_, k) => `cyc${tag}_${k}`);
+        for (let k = 0; k < n; k++) {
+            const next = names[(k + 1) % n];
+            lines.push(`${names[k]} = ${next} * ${2 + rng.int(3)} / ${2 + rng.int(3)}`);
+        }
+        if (vars.length > 0) lines.push(`${rng.pick(vars)} = ${names[0]} + ${names[n - 1]}`);
+        return `cycle of ${n}`;
+    },
+
+    manyUnknowns(lines, vars, rng, tag) {
+        const n = 3 + rng.int(6);
+        const names = Array.from({ length: n }, (_, k) => `unk${tag}_${k}`);
+        for (let k = 0; k + 1 < n; k++) {
+            lines.push(`${names[k]} * ${names[k + 1]} = ${names[(k + 2) % n]} + ${1 + rng.int(9)}`);
+        }
+        return `${n} coupled unknowns`;
+    },
+
+    widenLimits(lines, vars, rng) {
+        const withLimits = lines.map((l, i) => i).filter(i => LIMITS.test(lines[i]));
+        if (withLimits.length === 0) return null;
+        const i = rng.pick(withLimits);
+        const k = rng.pick([10, 100, 1000, 1e4]);
+        lines[i] = lines[i].replace(LIMITS, (m, lo, hi, step) =>
+            step ? `[(${lo})*${k}:(${hi})*${k}:(${step})/${k}]` : `[(${lo})*${k}:(${hi})*${k}]`);
+        return `widen limits on line ${i + 1} x${k}`;
+    },
+
+    addLimits(lines, vars, rng) {
+        const decls = lines.map((l, i) => i).filter(i => i > 0 && DECLARATION.test(lines[i]) && !lines[i].includes('['));
+        if (decls.length === 0) return null;
+        const i = rng.pick(decls);
+        const r = rng.pick(['1e3', '1e6', '1e9']);
+        const step = rng.next() < 0.5 ? `:${rng.pick(['0.001', '0.01', '1'])}` : '';
+        lines[i] = lines[i].replace(DECLARATION, (m, ws, name, ws2, marker) => `${ws}${name}[-${r}:${r}${step}]${ws2}${marker}`);
+        return `limits on line ${i + 1}`;
+    },
+
+    nestFunctions(lines, vars, rng, tag) {
+        if (vars.length < 2) return null;
+        const depth = 3 + rng.int(8);
+        const fn = k => `nest${tag}_${k}`;
+        lines.splice(1, 0, `${fn(0)}(x) = x * 1.5 - 0.25`);
+        for (let k = 1; k < depth; k++) {
+            lines.splice(1 + k, 0, `${fn(k)}(x) = ${fn(k - 1)}(x) + ${fn(k - 1)}(x / 2)`);
+        }
+        lines.push(`${rng.pick(vars)} = ${fn(depth - 1)}(${rng.pick(vars)})`);
+        return `nested functions depth ${depth}`;
+    },
+
+    duplicateBlock(lines, vars, rng) {
+        if (lines.length < 3) return null;
+        const from = 1 + rng.int(lines.length - 1);
+        const len = 1 + rng.int(Math.min(8, lines.length - from));
+        lines.push(...lines.slice(from, from + len));
+        return `duplicate lines ${from + 1}-${from + len}`;
+    }
+};
+
+/**
+ * Load the mutation corpus: every ordinary record in tests/input, with the
+ * reference records of its file.
+ */
+function loadCorpus() {
+    const inputDir = path.join(__dirname, 'input');
+    const corpus = [];
+    for (const file of fs.readdirSync(inputDir).filter(f => f.endsWith('.txt')).sort()) {
+        const data = importFromText(fs.readFileSync(path.join(inputDir, file), 'utf8'));
+        const refs = data.records.filter(r => isReferenceRecord(r, 'Constants') || isReferenceRecord(r, 'Functions'));
+        data.records.forEach((record, index) => {
+            if (refs.includes(record) || !record.text.trim()) return;
+            corpus.push({ file, index, record, refs });
+        });
+    }
+    return corpus;
+}
+
+function caseExport(refs, record, text) {
+    return exportToText({ records: [...refs, { ...record, text }] });
+}
+
+/**
+ * Delta-debug the record's lines (title line kept) down to a smaller
+ * input that still exceeds the budget.
+ */
+function minimize(refs, record, text, budget, maxSteps) {
+    let lines = text.split('\n');
+    let steps = 0;
+    const slow = (candidate) => {
+        steps++;
+        const r = timeInChild(caseExport(refs, record, candidate.join('\n')), budget);
+        return r.timedOut || r.ms > budget;
+    };
+    let chunks = 2;
+    while (lines.length > 2 && steps < maxSteps) {
+        const body = lines.length - 1;
+        const size = Math.ceil(body / chunks);
+        let reduced = false;
+        for (let start = 1; start < lines.length && steps < maxSteps; start += size) {
+            const candidate = [...lines.slice(0, start), ...lines.slice(start + size)];
+            if (candidate.length < lines.length && slow(candidate)) {
+                lines = candidate;
+                chunks = Math.max(chunks - 1, 2);
+                reduced = true;
+                break;
+            }
+        }
+        if (!reduced) {
+            if (size <= 1) break;
+            chunks = Math.min(chunks * 2, body);
+        }
+    }
+    return { text: lines.join('\n'), steps };
+}
+
+/**
+ * Append a tag to a record's title line, inside the closing quote when the
+ * title is a one-line comment. An unquoted title gets no quotes: a stray `"`
+ * would open a multi-line comment swallowing the rest of the record.
+ */
+function tagTitle(line, tag) {
+    const m = line.match(/^(\s*".*)"\s*$/);
+    if (m && m[1].trim().length > 1) return `${m[1]} ${tag}"`;
+    return `${line.replace(/\s+$/, '')} ${tag}`;
+}
+
+function parseArgs(argv) {
+    const opts = {
+        seed: 1, iterations: 50, budget: 2000, mutations: 4, minimizeSteps: 60,
+        out: path.join(__dirname, 'perf'), replay: null, profile: false
+    };
+    for (let i = 0; i < argv.length; i++) {
+        const num = () => parseFloat(argv[++i]);
+        switch (argv[i]) {
+            case '--seed': opts.seed = num(); break;
+            case '--iterations': opts.iterations = num(); break;
+            case '--budget': opts.budget = num(); break;
+            case '--mutations': opts.mutations = num(); break;
+            case '--minimize-steps': opts.minimizeSteps = num(); break;
+            case '--profile': opts.profile = true; break;
+            case '--out': opts.out = path.resolve(argv[++i]); break;
+            case '--replay':
+                opts.replay = [];
+                while (argv[i + 1] && !argv[i + 1].startsWith('--')) opts.replay.push(argv[++i]);
+                break;
+            default:
+                throw new Error(`Unknown option: ${argv[i]}`);
+        }
+    }
+    return opts;
+}
+
+function replay(files, budget, profile) {
+    let slowCount = 0;
+    let knownSlowCount = 0;
+    for (const file of files) {
+        const knownSlow = file.endsWith('.slow.txt');
+        const data = importFromText(fs.readFileSync(file, 'utf8'));
+        const refs = data.records.filter(r => isReferenceRecord(r, 'Constants') || isReferenceRecord(r, 'Functions'));
+        for (const record of data.records) {
+            if (refs.includes(record)) continue;
+            const r = timeInChild(caseExport(refs, record, record.text), budget, profile);
+            const slow = r.timedOut || r.ms > budget;
+            if (slow && knownSlow) knownSlowCount++;
+            else if (slow) slowCount++;
+            const status = knownSlow ? (slow ? 'slow' : 'FAST') : slow ? 'SLOW' : 'ok  ';
+            const ms = r.timedOut ? 'timeout' : r.error ? `error: ${r.error}` : `${r.ms.toFixed(1)} ms`;
+            const note = knownSlow && !slow ? '  known slow but within budget now: drop .slow from the name' : '';
+            console.log(`${status}  ${path.basename(file)}: ${record.text.split('\n')[0]}  (${ms})${note}`);
+            if (slow && r.report) console.log('\n' + r.report.replace(/^/gm, '    ') + '\n');
+        }
+    }
+    console.log(`\n${slowCount} record(s) over the ${budget} ms budget` +
+        (knownSlowCount > 0 ? `, plus ${knownSlowCount} known slow` : ''));
+    if (slowCount > 0) process.exit(1);
+}
+
+function search(opts) {
+    const rng = makeRng(opts.seed);
+    const corpus = loadCorpus();
+    const names = Object.keys(MUTATIONS);
+    let found = 0;
+    console.log(`Stress search: seed ${opts.seed}, ${opts.iterations} mutants, budget ${opts.budget} ms\n`);
+
+    for (let iter = 0; iter < opts.iterations; iter++) {
+        const base = rng.pick(corpus);
+        const lines = base.record.text.replace(/\n+$/, '').split('\n');
+        const vars = recordVariables(base.record.text);
+        const applied = [];
+        const count = 1 + rng.int(opts.mutations);
+        for (let m = 0; m < count; m++) {
+            const desc = MUTATIONS[rng.pick(names)](lines, vars, rng, `${iter}${m}`);
+            if (desc) applied.push(desc);
+        }
+        if (applied.length === 0) continue;
+
+        const text = lines.join('\n');
+        const r = timeInChild(caseExport(base.refs, base.record, text), opts.budget);
+        const label = `${base.file}#${base.index}`;
+        const ms = r.timedOut ? 'timeout' : r.error ? `error: ${r.error}` : `${r.ms.toFixed(1)} ms`;
+        if (!(r.timedOut || r.ms > opts.budget)) {
+            console.log(`  ${String(iter).padStart(4)}  ${label}  ${ms}`);
+            continue;
+        }
+
+        console.log(`  ${String(iter).padStart(4)}  ${label}  ${ms}  OVER BUDGET [${applied.join('; ')}]`);
+        const min = minimize(base.refs, base.record, text, opts.budget, opts.minimizeSteps);
+        const minLines = min.text.split('\n');
+        minLines[0] = tagTitle(minLines[0], `[stress seed ${opts.seed} #${iter}]`);
+        fs.mkdirSync(opts.out, { recursive: true });
+        const outFile = path.join(opts.out, `${path.basename(base.file, '.txt')}-s${opts.seed}-${iter}.txt`);
+        fs.writeFileSync(outFile, caseExport(base.refs, base.record, minLines.join('\n')) + '\n');
+        console.log(`        minimized ${lines.length} → ${minLines.length} lines in ${min.steps} solves: ${path.relative(process.cwd(), outFile)}`);
+        found++;
+    }
+    console.log(`\n${found} offender(s) found`);
+}
+
+// Main
+if (process.argv[2] === '--solve-child') {
+    loadModules();
+    const text = fs.readFileSync(0, 'utf8');
+    const { ms, reports } = solveExport(text, process.argv[3] === '--profile');
+    process.stdout.write([String(ms), ...reports].join('\n'));
+} else {
+    try {
+        const opts = parseArgs(process.argv.slice(2));
+        loadModules();
+        if (opts.replay) replay(opts.replay, opts.budget, opts.profile);
+        else search(opts);
+    } catch (e) {
+        console.error('Error:', e.message);
+        process.exit(1);
+    }
+}
@@ -0,0 +1,443 @@
+#!/usr/bin/env node
+/**
+ * MathPad Parameter Sweep and Monte Carlo
+ *
+ * Solves one record of a MathPad export for every row of a CSV file and
+ * writes the solved values as CSV. The CSV header names input variables of
+ * the record (declared with `name:` or `name<-`); each row's cells replace
+ * those inputs' values (an empty cell clears the input, so it is solved
+ * for). Output columns are the inputs followed by every other declared
+ * variable at full precision, then a status (ok, error or timeout) and the
+ * solve's error messages. Inputs left empty show the value solved for.
+ *
+ * With --dist, inputs are drawn from distributions instead and the record is
+ * solved once per sample; the report gives each output's mean, standard
+ * deviation and quantiles, and its rank correlation (Spearman) with each
+ * input. --out then saves the samples in the sweep's CSV format.
+ *
+ * Usage:
+ *   node tests/sweep.js EXPORT_FILE INPUT.csv [options]
+ *   node tests/sweep.js EXPORT_FILE --dist SPEC... [--samples N] [--seed N] [options]
+ *     --record N|TITLE  Record to solve: 1-based position among the
+ *                       non-reference records, or its title (default 1)
+ *     --out FILE        Output CSV (default stdout)
+ *     --workers N       Worker threads (default: one per CPU)
+ *     --timeout MS      Solve budget per row (default 5000)
+ *     --chunk N         Rows per work unit (default 256)
+ *     --dist SPEC       NAME=uniform(MIN,MAX), NAME=normal(MEAN,SD) or
+ *                       NAME=triangular(MIN,MODE,MAX); one per input. The
+ *                       numbers may use % and $ but not digit grouping
+ *     --samples N       Monte Carlo samples (default 10000)
+ *     --seed N          RNG seed (default 1); runs are reproducible per seed
+ *
+ * The record is parsed once per worker (prepareRecord) and rows are handed
+ * out in chunks. Each chunk starts with fresh solve plans, and a Monte Carlo
+ * chunk draws from its own RNG stream and warm-starts each solve from the
+ * previous sample's values, so the output is the same for any --workers
+ * count.
+ */
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+
+// Path to docs/js modules
+const jsPath = path.join(__dirname, '..', 'docs', 'js');
+
+function loadModules() {
+    for (const name of ['parser', 'line-parser', 'evaluator', 'solver', 'variables', 'storage', 'solve-engine']) {
+        Object.assign(global, require(path.join(jsPath, name + '.js')));
+    }
+}
+
+/**
+ * Parse CSV text (RFC 4180: quoted fields may hold commas, newlines and
+ * doubled quotes). Returns an array of rows, each an array of strings.
+ */
+function parseCsv(text) {
+    const rows = [];
+    let row = [];
+    let field = '';
+    let quoted = false;
+    for (let i = 0; i < text.length; i++) {
+        const c = text[i];
+        if (quoted) {
+            if (c === '"' && text[i + 1] === '"') { field += '"'; i++; }
+            else if (c === '"') quoted = false;
+            else field += c;
+        } else if (c === '"') {
+            quoted = true;
+        } else if (c === ',') {
+            row.push(field);
+            field = '';
+        } else if (c === '\n' || c === '\r') {
+            if (c === '\r' && text[i + 1] === '\n') i++;
+            row.push(field);
+            rows.push(row);
+            row = [];
+            field = '';
+        } else {
+            field += c;
+        }
+    }
+    if (field !== '' || row.length > 0) {
+        row.push(field);
+        rows.push(row);
+    }
+    return rows.filter(r => r.length > 1 || r[0].trim() !== '');
+}
+
+function csvField(value) {
+    const s = String(value);
+    return /[",\r\n]/.test(s) ? `"${s.replace(/"/g, '""')}"` : s;
+}
+
+function formatValue(value) {
+    if (value === undefined || value === null) return '';
+    return Array.isArray(value) ? value.join(' ') : String(value);
+}
+
+/**
+ * Pick the record to sweep and compile the export's reference records.
+ * Returns the data a worker needs to prepare the record itself.
+ */
+function loadRecord(exportText, selector) {
+    const data = importFromText(exportText);
+    const constantsRecord = data.records.find(r => isReferenceRecord(r, 'Constants'));
+    const functionsRecord = data.records.find(r => isReferenceRecord(r, 'Functions'));
+    const candidates = data.records.filter(r => r.category !== 'Reference');
+    let record;
+    if (/^\d+$/.test(selector)) {
+        record = candidates[parseInt(selector, 10) - 1];
+    } else {
+        record = candidates.find(r => r.title === selector);
+    }
+    if (!record) throw new Error(`No record ${JSON.stringify(selector)} in the export`);
+    return {
+        text: record.text,
+        record: { ...record },
+        constantsText: constantsRecord ? constantsRecord.text : null,
+        functionsText: functionsRecord ? functionsRecord.text : null
+    };
+}
+
+function prepare(loaded, inputNames) {
+    const parsedConstants = loaded.constantsText !== null ? parseConstantsRecord(loaded.constantsText) : null;
+    const parsedFunctions = loaded.functionsText !== null ? parseFunctionsRecord(loaded.functionsText) : null;
+    return prepareRecord(loaded.text, loaded.record, parsedConstants, parsedFunctions, inputNames);
+}
+
+/**
+ * Distributions for --dist: parameter count and a sampler given an RNG
+ * and the parameters
+ */
+const DISTRIBUTIONS = {
+    uniform: {
+        params: 2,
+        check: ([min, max]) => min <= max,
+        sample: (rng, [min, max]) => min + (max - min) * rng.next()
+    },
+    normal: {
+        params: 2,
+        check: ([, sd]) => sd >= 0,
+        // Box-Muller
+        sample: (rng, [mean, sd]) =>
+            mean + sd * Math.sqrt(-2 * Math.log(1 - rng.next())) * Math.cos(2 * Math.PI * rng.next())
+    },
+    triangular: {
+        params: 3,
+        check: ([min, mode, max]) => min <= mode && mode <= max && min < max,
+        // Inverse CDF
+        sample: (rng, [min, mode, max]) => {
+            const u = rng.next();
+            const split = (mode - min) / (max - min);
+            return u < split
+                ? min + Math.sqrt(u * (max - min) * (mode - min))
+                : max - Math.sqrt((1 - u) * (max - min) * (max - mode));
+        }
+    }
+};
+
+function parseDist(spec) {
+    const m = spec.match(/^\s*(\w+)\s*=\s*(\w+)\s*\((.*)\)\s*$/);
+    const dist = m && DISTRIBUTIONS[m[2]];
+    if (!dist) throw new Error(`Bad --dist ${JSON.stringify(spec)} (expected e.g. rate=normal(6%,0.5%))`);
+    const params = m[3].split(',').map(p => evaluate(parseExpression(p.trim()), new EvalContext()));
+    if (params.length !== dist.params || !params.every(Number.isFinite) || !dist.check(params)) {
+        throw new Error(`Bad parameters in --dist ${JSON.stringify(spec)}`);
+    }
+    return { name: m[1], kind: m[2], params };
+}
+
+function makeRng(seed) {
+    let a = seed >>> 0;
+    return {
+        next: () => {
+            a = (a + 0x6D2B79F5) >>> 0;
+            let t = a;
+            t = Math.imul(t ^ (t >>> 15), t | 1);
+            t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+            return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+        }
+    };
+}
+
+/**
+ * Draw the input rows of one Monte Carlo chunk from the chunk's own RNG
+ * stream, so samples don't depend on which worker solves the chunk
+ */
+function sampleRows(dists, seed, index, count) {
+    const rng = makeRng(seed ^ Math.imul(index + 1, 0x9E3779B1));
+    const rows = [];
+    for (let i = 0; i < count; i++) {
+        rows.push(dists.map(d => String(DISTRIBUTIONS[d.kind].sample(rng, d.params))));
+    }
+    return rows;
+}
+
+/**
+ * Solve one chunk of rows; returns the cells of each row: the inputs
+ * (solved values filled into empty ones), outputs, status and message.
+ * With warm, each solve starts from the previous solved row's values.
+ */
+function solveChunk(prepared, rows, timeoutMs, warm = false) {
+    prepared.plans = new SolvePlans();
+    let warmStart = null;
+    return rows.map(row => {
+        try {
+            const r = solvePrepared(prepared, row, timeoutMs, warmStart);
+            const status = r.timedOut ? 'timeout' : r.errors.length > 0 ? 'error' : 'ok';
+            if (warm && status === 'ok') {
+                warmStart = new Map();
+                prepared.outputNames.forEach((name, i) => {
+                    if (typeof r.values[i] === 'number') warmStart.set(name, r.values[i]);
+                });
+            }
+            const inputs = row.map((cell, i) => cell !== '' ? cell : formatValue(r.inputValues[i]));
+            return [...inputs, ...r.values.map(formatValue), status, r.errors.join('; ')];
+        } catch (e) {
+            return [...row, ...prepared.outputNames.map(() => ''), 'error', e.message];
+        }
+    });
+}
+
+/**
+ * Solve one work unit: a chunk of CSV rows, or a Monte Carlo chunk whose
+ * rows are drawn here
+ */
+function solveUnit(prepared, unit, config) {
+    if (unit.rows) return solveChunk(prepared, unit.rows, config.timeout);
+    const rows = sampleRows(config.dists, config.seed, unit.index, unit.count);
+    return solveChunk(prepared, rows, config.timeout, true);
+}
+
+function parseArgs(argv) {
+    const opts = {
+        files: [], record: '1', out: null, workers: os.cpus().length, timeout: 5000, chunk: 256,
+        dists: [], samples: 10000, seed: 1
+    };
+    for (let i = 0; i < argv.length; i++) {
+        const num = () => parseFloat(argv[++i]);
+        switch (argv[i]) {
+            case '--record': opts.record = argv[++i]; break;
+            case '--out': opts.out = path.resolve(argv[++i]); break;
+            case '--workers': opts.workers = Math.max(1, num()); break;
+            case '--timeout': opts.timeout = num(); break;
+            case '--chunk': opts.chunk = Math.max(1, num()); break;
+            case '--dist':
+                while (argv[i + 1] && !argv[i + 1].startsWith('--')) opts.dists.push(argv[++i]);
+                break;
+            case '--samples': opts.samples = Math.max(1, num()); break;
+            case '--seed': opts.seed = num(); break;
+            default:
+                if (argv[i].startsWith('--')) throw new Error(`Unknown option: ${argv[i]}`);
+                opts.files.push(argv[i]);
+        }
+    }
+    if (opts.files.length !== (opts.dists.length > 0 ? 1 : 2)) {
+        throw new Error('Usage: node tests/sweep.js EXPORT_FILE (INPUT.csv | --dist SPEC...) [options]');
+    }
+    return opts;
+}
+
+/**
+ * Solve all work units, in-process for a single worker or unit, otherwise
+ * on worker threads pulling units from a shared queue. Resolves to the
+ * cells of every row, in unit order.
+ */
+function runUnits(loaded, inputNames, units, config, workers) {
+    const workerCount = Math.min(workers, units.length);
+    if (workerCount <= 1) {
+        const prepared = prepare(loaded, inputNames);
+        return Promise.resolve(units.flatMap(unit => solveUnit(prepared, unit, config)));
+    }
+
+    return new Promise((resolve, reject) => {
+        const results = new Array(units.length);
+        let next = 0;
+        let done = 0;
+        const threads = [];
+        const dispatch = worker => {
+            worker.postMessage(next < units.length ? units[next++] : null);
+        };
+        for (let w = 0; w < workerCount; w++) {
+            const worker = new Worker(__filename, { workerData: { loaded, inputNames, config } });
+            worker.on('message', msg => {
+                results[msg.index] = msg.results;
+                done++;
+                if (done === units.length) resolve(results.flat());
+                dispatch(worker);
+            });
+            worker.on('error', e => {
+                for (const other of threads) other.terminate();
+                reject(e);
+            });
+            threads.push(worker);
+            dispatch(worker);
+        }
+    });
+}
+
+function writeCsv(file, header, results) {
+    const lines = [header.map(csvField).join(',')];
+    for (const cells of results) lines.push(cells.map(csvField).join(','));
+    const csv = lines.join('\n') + '\n';
+    if (file) fs.writeFileSync(file, csv);
+    else process.stdout.write(csv);
+}
+
+function quantile(sorted, p) {
+    const pos = (sorted.length - 1) * p;
+    const lo = Math.floor(pos);
+    const hi = Math.min(lo + 1, sorted.length - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - lo);
+}
+
+// Ranks from 1, ties sharing their average rank
+function ranks(values) {
+    const order = values.map((v, i) => i).sort((a, b) => values[a] - values[b]);
+    const result = new Array(values.length);
+    for (let i = 0; i < order.length;) {
+        let j = i;
+        while (j + 1 < order.length && values[order[j + 1]] === values[order[i]]) j++;
+        for (let k = i; k <= j; k++) result[order[k]] = (i + j) / 2 + 1;
+        i = j + 1;
+    }
+    return result;
+}
+
+// Spearman's rank correlation: Pearson's correlation of the ranks
+function rankCorrelation(x, y) {
+    const rx = ranks(x);
+    const ry = ranks(y);
+    const mean = (rx.length + 1) / 2;
+    let sxy = 0, sxx = 0, syy = 0;
+    for (let i = 0; i < rx.length; i++) {
+        sxy += (rx[i] - mean) * (ry[i] - mean);
+        sxx += (rx[i] - mean) ** 2;
+        syy += (ry[i] - mean) ** 2;
+    }
+    return sxx > 0 && syy > 0 ? sxy / Math.sqrt(sxx * syy) : NaN;
+}
+
+/**
+ * Summarize Monte Carlo results over the samples that solved: per numeric
+ * output its mean, standard deviation and quantiles, and its rank
+ * correlation with each input
+ */
+function monteCarloReport(inputNames, outputNames, results) {
+    const ok = results.filter(r => r[r.length - 2] === 'ok');
+    const inputs = inputNames.map((_, i) => ok.map(r => parseFloat(r[i])));
+    const fmt = v => Number.isFinite(v) ? v.toPrecision(6) : '-';
+    const pad = (cells, widths) => cells.map((c, i) => i === 0 ? c.padEnd(widths[i]) : c.padStart(widths[i])).join('  ');
+
+    const lines = [`${results.length} samples, ${ok.length} solved\n`];
+    const head = ['output', 'mean', 'sd', 'p5', 'p25', 'p50', 'p75', 'p95'];
+    const stats = [];
+    const corr = [];
+    outputNames.forEach((name, o) => {
+        const values = ok.map(r => parseFloat(r[inputNames.length + o]));
+        if (values.length === 0 || !values.every(Number.isFinite)) return;
+        const sorted = values.slice().sort((a, b) => a - b);
+        const mean = values.reduce((a, b) => a + b, 0) / values.length;
+        const sd = Math.sqrt(values.reduce((a, v) => a + (v - mean) ** 2, 0) / Math.max(1, values.length - 1));
+        stats.push([name, fmt(mean), fmt(sd), ...[0.05, 0.25, 0.5, 0.75, 0.95].map(p => fmt(quantile(sorted, p)))]);
+        corr.push([name, ...inputs.map(x => {
+            const c = rankCorrelation(x, values);
+            return Number.isFinite(c) ? c.toFixed(3) : '-';
+        })]);
+    });
+    if (stats.length === 0) return lines.concat('No numeric outputs solved').join('\n');
+
+    const widths = head.map((h, i) => Math.max(h.length, ...stats.map(r => r[i].length)));
+    lines.push(pad(head, widths), ...stats.map(r => pad(r, widths)));
+    const corrHead = ['rank corr', ...inputNames];
+    const corrWidths = corrHead.map((h, i) => Math.max(h.length, 6, ...corr.map(r => r[i].length)));
+    lines.push('', pad(corrHead, corrWidths), ...corr.map(r => pad(r, corrWidths)));
+    return lines.join('\n');
+}
+
+async function main(opts) {
+    loadModules();
+    const loaded = loadRecord(fs.readFileSync(opts.files[0], 'utf8'), opts.record);
+    const config = { timeout: opts.timeout };
+    let inputNames, units;
+    if (opts.dists.length > 0) {
+        config.dists = opts.dists.map(parseDist);
+        config.seed = opts.seed;
+        inputNames = config.dists.map(d => d.name);
+        units = [];
+        for (let i = 0; i * opts.chunk < opts.samples; i++) {
+            units.push({ index: i, count: Math.min(opts.chunk, opts.samples - i * opts.chunk) });
+        }
+    } else {
+        const [header, ...rows] = parseCsv(fs.readFileSync(opts.files[1], 'utf8'));
+        if (!header) throw new Error('Input CSV is empty');
+        inputNames = header.map(h => h.trim());
+        const padded = rows.map(row => inputNames.map((_, i) => (row[i] || '').trim()));
+        units = [];
+        for (let i = 0; i < padded.length; i += opts.chunk) {
+            units.push({ index: units.length, rows: padded.slice(i, i + opts.chunk) });
+        }
+    }
+    // Check the inputs (and get the output names) before starting workers
+    const { outputNames } = prepare(loaded, inputNames);
+
+    const start = process.hrtime.bigint();
+    const results = await runUnits(loaded, inputNames, units, config, opts.workers);
+    const ms = Number(process.hrtime.bigint() - start) / 1e6;
+
+    const header = [...inputNames, ...outputNames, 'status', 'message'];
+    if (opts.dists.length > 0) {
+        if (opts.out) writeCsv(opts.out, header, results);
+        console.log(monteCarloReport(inputNames, outputNames, results));
+    } else {
+        writeCsv(opts.out, header, results);
+    }
+    const failed = results.filter(r => r[r.length - 2] !== 'ok').length;
+    console.error(`${results.length} row(s) in ${ms.toFixed(0)} ms, ${failed} not ok`);
+}
+
+// Main
+if (!isMainThread) {
+    loadModules();
+    const prepared = prepare(workerData.loaded, workerData.inputNames);
+    parentPort.on('message', unit => {
+        if (unit === null) {
+            parentPort.close();
+            return;
+        }
+        parentPort.postMessage({ index: unit.index, results: solveUnit(prepared, unit, workerData.config) });
+    });
+} else {
+    try {
+        main(parseArgs(process.argv.slice(2))).catch(e => {
+            console.error('Error:', e.message);
+            process.exit(1);
+        });
+    } catch (e) {
+        console.error('Error:', e.message);
+        process.exit(1);
+    }
+}